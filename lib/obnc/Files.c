@@ -4,11 +4,16 @@ This Source Code Form is subject to the terms of the Mozilla Public
 License, v. 2.0. If a copy of the MPL was not distributed with this
 file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 
+#if defined __linux__ && ! defined _GNU_SOURCE
+	#define _GNU_SOURCE /*O_TMPFILE*/
+#endif
+
 #include ".obnc/Files.h"
 #include <obnc/OBNC.h>
 #ifdef _WIN32
 	#include <windows.h>
 #else
+	#include <fcntl.h>
 	#include <unistd.h>
 #endif
 #include <sys/stat.h>
@@ -20,14 +25,31 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #include <time.h>
 
 #define LEN(arr) ((int) (sizeof (arr) / sizeof (arr)[0]))
+#define INTEGER_BITS ((int) (CHAR_BIT * sizeof (OBNC_INTEGER)))
+#define MAX_NUM_LEN ((INTEGER_BITS + 6) / 7) /*maximum length of a compactly encoded integer*/
 
 typedef struct Handle *File;
 
+/*An unregistered file is backed by one of the following kinds of temporary files*/
+
+#define ANONYMOUS_TEMP 0 /*unnamed file in the system's temporary directory, registered by copying*/
+#define LINKABLE_TEMP 1 /*unnamed file in the destination directory (O_TMPFILE), registered by linking*/
+#define NAMED_TEMP 2 /*hidden file in the destination directory, registered by renaming*/
+
 struct Handle {
 	Files__Handle_ base;
 	FILE *file;
 	char *name;
 	int registered;
+	int tempKind;
+	struct TempFile *temp; /*non-NULL if tempKind = NAMED_TEMP*/
+};
+
+/*Hidden files in destination directories which are deleted at exit if they have not been registered*/
+
+struct TempFile {
+	char *path;
+	struct TempFile *next;
 };
 
 struct HeapHandle {
@@ -72,6 +94,8 @@ static File NewFile(FILE *file, const char name[], int registered)
 		if (result->name != NULL) {
 			memcpy(result->name, name, nameLen);
 			result->registered = registered;
+			result->tempKind = ANONYMOUS_TEMP;
+			result->temp = NULL;
 		} else {
 			result = NULL;
 		}
@@ -102,17 +126,232 @@ Files__File_ Files__Old_(const char name[], OBNC_INTEGER nameLen)
 	return (Files__File_) result;
 }
 
+#ifndef _WIN32
+
+static struct TempFile *tempFiles;
+
+static void DeleteTempFiles(void)
+{
+	struct TempFile *p;
+
+	for (p = tempFiles; p != NULL; p = p->next) {
+		unlink(p->path);
+	}
+}
+
+
+static struct TempFile *NewTempEntry(char *path)
+{
+	static int atexitCalled = 0;
+	struct TempFile *result;
+
+	if (! atexitCalled) {
+		atexit(DeleteTempFiles);
+		atexitCalled = 1;
+	}
+	result = malloc(sizeof *result);
+	if (result != NULL) {
+		result->path = path;
+		result->next = tempFiles;
+		tempFiles = result;
+	}
+	return result;
+}
+
+
+static void DeleteTempEntry(struct TempFile *entry)
+{
+	struct TempFile **p;
+
+	p = &tempFiles;
+	while ((*p != NULL) && (*p != entry)) {
+		p = &(*p)->next;
+	}
+	if (*p != NULL) {
+		*p = entry->next;
+		free(entry->path);
+		free(entry);
+	}
+}
+
+
+/*returns a name template ending in XXXXXX for a hidden file in the same directory as path*/
+static char *TempTemplate(const char path[])
+{
+	const char *slash;
+	size_t dirLen, baseLen;
+	char *result;
+
+	slash = strrchr(path, '/');
+	dirLen = (slash != NULL)? (size_t) (slash - path) + 1: 0;
+	baseLen = strlen(path + dirLen);
+	result = malloc(dirLen + baseLen + strlen("..XXXXXX") + 1);
+	if (result != NULL) {
+		memcpy(result, path, dirLen);
+		result[dirLen] = '.';
+		memcpy(result + dirLen + 1, path + dirLen, baseLen);
+		strcpy(result + dirLen + 1 + baseLen, ".XXXXXX");
+	}
+	return result;
+}
+
+
+/*replaces the six characters at the end of template with random letters and digits, like mkstemp*/
+static void RandomizeTemplate(char template[])
+{
+	static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+	static OBNC_THREAD_LOCAL unsigned long state;
+	char *suffix;
+	int i;
+
+	if (state == 0) {
+		state = ((unsigned long) time(NULL) << 16) ^ (unsigned long) getpid() ^ (unsigned long) clock() ^ (unsigned long) &state ^ 0x5DEECE66DUL;
+	}
+	suffix = template + strlen(template) - 6;
+	for (i = 0; i < 6; i++) {
+		/*xorshift*/
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		suffix[i] = chars[state % (sizeof chars - 1)];
+	}
+}
+
+
+#ifdef O_TMPFILE
+
+static char *DirName(const char path[])
+{
+	const char *slash;
+	size_t len;
+	char *result;
+
+	slash = strrchr(path, '/');
+	if (slash == NULL) {
+		len = 1;
+		path = ".";
+	} else if (slash == path) {
+		len = 1;
+	} else {
+		len = (size_t) (slash - path);
+	}
+	result = malloc(len + 1);
+	if (result != NULL) {
+		memcpy(result, path, len);
+		result[len] = '\0';
+	}
+	return result;
+}
+
+#endif
+
+/*creates a temporary file in the directory of name which can later be given the name without copying its content*/
+static FILE *NewLocalTemp(const char name[], int *kind, struct TempFile **entry)
+{
+	FILE *result;
+	char *path;
+	int fd, attempts;
+
+	result = NULL;
+	*entry = NULL;
+#ifdef O_TMPFILE
+	path = DirName(name);
+	if (path != NULL) {
+		fd = open(path, O_TMPFILE | O_RDWR, 0666);
+		free(path);
+		if (fd >= 0) {
+			result = fdopen(fd, "w+b");
+			if (result != NULL) {
+				*kind = LINKABLE_TEMP;
+			} else {
+				close(fd);
+			}
+		}
+	}
+#endif
+	if (result == NULL) {
+		path = TempTemplate(name);
+		if (path != NULL) {
+			attempts = 0;
+			do {
+				RandomizeTemplate(path);
+				fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0666); /*unlike with mkstemp, the umask applies*/
+				attempts++;
+			} while ((fd < 0) && (errno == EEXIST) && (attempts < 100));
+			if (fd >= 0) {
+				result = fdopen(fd, "w+b");
+				if (result != NULL) {
+					*entry = NewTempEntry(path);
+				}
+				if ((result == NULL) || (*entry == NULL)) {
+					unlink(path);
+					free(path);
+					if (result != NULL) {
+						fclose(result);
+						result = NULL;
+					} else {
+						close(fd);
+					}
+				} else {
+					*kind = NAMED_TEMP;
+				}
+			} else {
+				free(path);
+			}
+		}
+	}
+	return result;
+}
+
+#endif
+
+/*creates the backing file of an unregistered file with the given name*/
+static FILE *NewTemp(const char name[], int *kind, struct TempFile **entry)
+{
+	FILE *result;
+
+	*kind = ANONYMOUS_TEMP;
+	*entry = NULL;
+#ifdef _WIN32
+	result = tmpfile();
+#else
+	result = NewLocalTemp(name, kind, entry);
+	if (result == NULL) { /*destination directory is not writable*/
+		result = tmpfile();
+	}
+#endif
+	return result;
+}
+
+
+static void DeleteTemp(File f)
+{
+#ifndef _WIN32
+	if (f->temp != NULL) {
+		unlink(f->temp->path);
+		DeleteTempEntry(f->temp);
+		f->temp = NULL;
+	}
+#endif
+}
+
 
 Files__File_ Files__New_(const char name[], OBNC_INTEGER nameLen)
 {
 	FILE *file;
 	File result;
+	int kind;
+	struct TempFile *entry;
 
 	OBNC_C_ASSERT(OBNC_Terminated(name, nameLen));
 
-	file = tmpfile();
+	file = NewTemp(name, &kind, &entry);
 	if (file != NULL) {
 		result = NewFile(file, name, 0);
+		if (result != NULL) {
+			result->tempKind = kind;
+			result->temp = entry;
+		}
 	} else {
 		result = NULL;
 		fprintf(stderr, "Files.New failed: %s\n", strerror(errno));
@@ -123,16 +362,14 @@ Files__File_ Files__New_(const char name[], OBNC_INTEGER nameLen)
 
 static void Copy(FILE *src, FILE *dst, const char dstName[], int *done)
 {
-	int ch;
+	char buf[BUFSIZ];
+	size_t n, nWritten;
 
 	rewind(src);
-	ch = fgetc(src);
-	while (ch != EOF) {
-		ch = fputc(ch, dst);
-		if (ch != EOF) {
-			ch = fgetc(src);
-		}
-	}
+	do {
+		n = fread(buf, 1, sizeof buf, src);
+		nWritten = fwrite(buf, 1, n, dst);
+	} while ((n == sizeof buf) && (nWritten == n));
 	*done = ! ferror(src) && ! ferror(dst);
 	if (ferror(src) || ferror(dst)) {
 		fprintf(stderr, "Files.Register failed: %s: %s\n", dstName, strerror(errno));
@@ -140,26 +377,104 @@ static void Copy(FILE *src, FILE *dst, const char dstName[], int *done)
 }
 
 
-void Files__Register_(Files__File_ file)
+static void RegisterByCopying(File f)
 {
-	File f;
 	FILE *new;
 	int done;
 
+	new = fopen(f->name, "w+b");
+	if (new != NULL) {
+		Copy(f->file, new, f->name, &done);
+		if (done) {
+			fclose(f->file);
+			f->file = new;
+			f->registered = 1;
+		} else {
+			fclose(new);
+		}
+	} else {
+		fprintf(stderr, "Files.Register failed: %s: %s\n", f->name, strerror(errno));
+	}
+}
+
+#ifndef _WIN32
+
+/*gives the unnamed file f a hidden name in the destination directory*/
+static char *LinkTemp(File f)
+{
+	char *result;
+	char fdPath[32];
+	int error, attempts;
+
+	result = TempTemplate(f->name);
+	if (result != NULL) {
+		sprintf(fdPath, "/proc/self/fd/%d", fileno(f->file));
+		attempts = 0;
+		do {
+			RandomizeTemplate(result);
+			error = linkat(AT_FDCWD, fdPath, AT_FDCWD, result, AT_SYMLINK_FOLLOW);
+			attempts++;
+		} while (error && (errno == EEXIST) && (attempts < 100));
+		if (error) {
+			free(result);
+			result = NULL;
+		}
+	}
+	return result;
+}
+
+#endif
+
+void Files__Register_(Files__File_ file)
+{
+	File f;
+#ifndef _WIN32
+	char *path;
+	int error, crossDevice;
+#endif
+
 	OBNC_C_ASSERT(file != NULL);
 
 	f = (File) file;
 	if (! f->registered) {
-		new = fopen(f->name, "w+b");
-		if (new != NULL) {
-			Copy(f->file, new, f->name, &done);
-			if (done) {
-				f->file = new;
+#ifdef _WIN32
+		RegisterByCopying(f);
+#else
+		path = NULL;
+		crossDevice = 0;
+		if (fflush(f->file) == 0) {
+			if (f->tempKind == LINKABLE_TEMP) {
+				path = LinkTemp(f);
+			} else if (f->tempKind == NAMED_TEMP) {
+				path = f->temp->path;
+			}
+		}
+		if (path != NULL) {
+			error = rename(path, f->name);
+			if (! error) {
 				f->registered = 1;
+			} else if (errno == EXDEV) {
+				crossDevice = 1;
+			} else {
+				fprintf(stderr, "Files.Register failed: %s: %s\n", f->name, strerror(errno));
+			}
+			if (f->tempKind == LINKABLE_TEMP) {
+				if (! f->registered) {
+					unlink(path);
+				}
+				free(path);
+			} else if (f->registered) {
+				DeleteTempEntry(f->temp);
+				f->temp = NULL;
 			}
-		} else {
-			fprintf(stderr, "Files.Register failed: %s: %s\n", f->name, strerror(errno));
 		}
+		if ((path == NULL) || crossDevice) {
+			RegisterByCopying(f);
+			if (f->registered) {
+				DeleteTemp(f);
+			}
+		}
+#endif
 	}
 }
 
@@ -192,7 +507,8 @@ void Files__Purge_(Files__File_ file)
 		if (f->registered) {
 			f->file = fopen(f->name, "w+b");
 		} else {
-			f->file = tmpfile();
+			DeleteTemp(f);
+			f->file = NewTemp(f->name, &f->tempKind, &f->temp);
 		}
 		if (f->file == NULL) {
 			fprintf(stderr, "Files.Purge failed: %s: %s\n", f->name, strerror(errno));
@@ -449,6 +765,69 @@ void Files__ReadNum_(Files__Rider_ *r, const OBNC_Td *rTD, OBNC_INTEGER *x)
 }
 
 
+void Files__ReadNums_(Files__Rider_ *r, const OBNC_Td *rTD, OBNC_INTEGER x[], OBNC_INTEGER xLen, OBNC_INTEGER n)
+{
+	FILE *fp;
+	unsigned char buf[BUFSIZ];
+	size_t len, i, nRead;
+	OBNC_INTEGER k;
+	unsigned OBNC_INTEGER sum;
+	int ch, s;
+
+	OBNC_C_ASSERT(r != NULL);
+	OBNC_C_ASSERT(r->base_ != NULL);
+	OBNC_C_ASSERT(x != NULL);
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= xLen);
+
+	Position(r, &fp);
+	if (fp != NULL) {
+		/*decode the bytes of each buffered block in one pass; a number may continue in the next block*/
+		k = 0;
+		sum = 0;
+		s = 0;
+		len = 0;
+		i = 0;
+		nRead = 0;
+		while (k < n) {
+			if (i == len) {
+				len = fread(buf, sizeof buf[0], LEN(buf), fp);
+				nRead += len;
+				i = 0;
+				if (len == 0) {
+					break;
+				}
+			}
+			ch = buf[i];
+			i++;
+			if (ch < 128) {
+				if (s < INTEGER_BITS) {
+					sum += (unsigned OBNC_INTEGER) ((ch & 63) - (ch & 64)) << s;
+				}
+				x[k] = (OBNC_INTEGER) sum;
+				k++;
+				sum = 0;
+				s = 0;
+			} else {
+				if (s < INTEGER_BITS) {
+					sum += (unsigned OBNC_INTEGER) (ch - 128) << s;
+				}
+				s += 7;
+			}
+		}
+		r->pos_ += (OBNC_INTEGER) (nRead - (len - i));
+		r->res_ = n - k;
+		if (k < n) {
+			if (feof(fp)) {
+				r->eof_ = 1;
+			} else if (ferror(fp)) {
+				fprintf(stderr, "Files.ReadNums failed: %s: %s\n", BaseName(r), strerror(errno));
+			}
+		}
+	}
+}
+
+
 void Files__ReadString_(Files__Rider_ *r, const OBNC_Td *rTD, char s[], OBNC_INTEGER sLen)
 {
 	FILE *fp;
@@ -656,6 +1035,55 @@ void Files__WriteNum_(Files__Rider_ *r, const OBNC_Td *rTD, OBNC_INTEGER x)
 }
 
 
+void Files__WriteNums_(Files__Rider_ *r, const OBNC_Td *rTD, const OBNC_INTEGER x[], OBNC_INTEGER xLen, OBNC_INTEGER n)
+{
+	FILE *fp;
+	unsigned char buf[BUFSIZ];
+	size_t len, nWritten;
+	OBNC_INTEGER k, kWritten, y;
+
+	OBNC_C_ASSERT(r != NULL);
+	OBNC_C_ASSERT(r->base_ != NULL);
+	OBNC_C_ASSERT(x != NULL);
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= xLen);
+
+	Position(r, &fp);
+	if (fp != NULL) {
+		/*encode into a local buffer and write it a block at a time*/
+		kWritten = 0;
+		len = 0;
+		k = 0;
+		while (k <= n) {
+			if ((k == n) || (len > (size_t) (LEN(buf) - MAX_NUM_LEN))) {
+				nWritten = fwrite(buf, sizeof buf[0], len, fp);
+				r->pos_ += (OBNC_INTEGER) nWritten;
+				if (nWritten < len) {
+					break;
+				}
+				kWritten = k;
+				len = 0;
+			}
+			if (k < n) {
+				y = x[k];
+				while ((y < -64) || (y > 63)) {
+					buf[len] = (unsigned char) ((y & 127) + 128);
+					len++;
+					y = OBNC_ASR(y, 7);
+				}
+				buf[len] = (unsigned char) (y & 127);
+				len++;
+			}
+			k++;
+		}
+		r->res_ = n - kWritten;
+		if (ferror(fp)) {
+			fprintf(stderr, "Files.WriteNums failed: %s: %s\n", BaseName(r), strerror(errno));
+		}
+	}
+}
+
+
 void Files__WriteString_(Files__Rider_ *r, const OBNC_Td *rTD, const char s[], OBNC_INTEGER sLen)
 {
 	FILE *fp;
@@ -9,9 +9,30 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #include <ctype.h>
 #include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-#define LEN(arr) ((int) (sizeof (arr) / sizeof (arr)[0]))
+#define GET() OBNC_GET_INPUT()
+
+#define MAX_INT_LEN ((CHAR_BIT * (int) sizeof (OBNC_INTEGER) / 3) + 3) /*including sign*/
+
+/*MAX_EXACT_DIGITS is the number of decimal digits and MAX_EXACT_POWER the largest power of ten that are always exact in an OBNC_REAL*/
+#if OBNC_CONFIG_C_REAL_TYPE == OBNC_CONFIG_FLOAT
+	#define MAX_EXACT_DIGITS 7
+	#define MAX_EXACT_POWER 10
+	#define STRTOREAL strtof
+#elif OBNC_CONFIG_C_REAL_TYPE == OBNC_CONFIG_LONG_DOUBLE
+	#define MAX_EXACT_DIGITS 15
+	#define MAX_EXACT_POWER 22
+	#define STRTOREAL strtold
+#else
+	#define MAX_EXACT_DIGITS 15
+	#define MAX_EXACT_POWER 22
+	#define STRTOREAL strtod
+#endif
+
+static char *text; /*text of the real number being read*/
+static size_t textSize;
 
 int In__Done_ = 0;
 static int inputConsumed = 0;
@@ -26,7 +47,7 @@ void In__Char_(char *ch)
 {
 	int d;
 
-	d = getchar();
+	d = GET();
 	*ch = (char) d;
 	In__Done_ = d != EOF;
 	if (In__Done_) {
@@ -35,79 +56,250 @@ void In__Char_(char *ch)
 }
 
 
-void In__Int_(OBNC_INTEGER *x)
+static int HexDigitValue(int ch)
+{
+	return isdigit(ch)? ch - '0': ch - 'A' + 10;
+}
+
+
+static int ReadInt(OBNC_INTEGER *x)
 {
-	int ch, i, n;
-	char buf[(CHAR_BIT * sizeof (OBNC_INTEGER) / 3) + 3];
-	unsigned OBNC_INTEGER y;
+	int ch, i, neg, decimal, d, done;
+	unsigned OBNC_INTEGER dec, hex, limit;
 
-	In__Done_ = 0;
+	done = 0;
 	do {
-		ch = getchar();
+		ch = GET();
 	} while (isspace(ch));
 	i = 0;
-	if (ch == '-') {
-		buf[i] = (char) ch;
+	neg = ch == '-';
+	if (neg) {
 		i++;
-		ch = getchar();
+		ch = GET();
 	}
 	if (isdigit(ch)) {
+		/*accumulate the decimal and the hexadecimal value at the same time; a decimal number ends at the first hex letter*/
+		limit = neg? (unsigned OBNC_INTEGER) OBNC_INT_MAX + 1: (unsigned OBNC_INTEGER) OBNC_INT_MAX;
+		dec = 0;
+		hex = 0;
+		decimal = 1;
 		do {
-			buf[i] = (char) ch;
+			d = HexDigitValue(ch);
+			if (d >= 10) {
+				decimal = 0;
+			} else if (decimal) {
+				dec = (dec <= (limit - (unsigned OBNC_INTEGER) d) / 10)? dec * 10 + (unsigned OBNC_INTEGER) d: limit;
+			}
+			hex = (hex <= (OBNC_UINT_MAX - (unsigned OBNC_INTEGER) d) / 16)? hex * 16 + (unsigned OBNC_INTEGER) d: OBNC_UINT_MAX;
 			i++;
-			ch = getchar();
-		} while ((isdigit(ch) || ((ch >= 'A') && (ch <= 'F'))) && (i < LEN(buf)));
-		if (i < LEN(buf)) {
-			buf[i] = '\0';
+			ch = GET();
+		} while ((isdigit(ch) || ((ch >= 'A') && (ch <= 'F'))) && (i < MAX_INT_LEN));
+		if (i < MAX_INT_LEN) {
 			if (ch == 'H') {
-				n = sscanf(buf, "%" OBNC_INT_MOD "x", &y);
-				if (n == 1) {
-					*x = (OBNC_INTEGER) y;
-				}
+				*x = (OBNC_INTEGER) (neg? 0 - hex: hex);
 			} else {
-				n = sscanf(buf, "%" OBNC_INT_MOD "d", x);
-				if (ch != EOF) {
-					ungetc(ch, stdin);
-				}
+				*x = neg? -(OBNC_INTEGER) (dec - 1) - 1: (OBNC_INTEGER) dec;
+				OBNC_UngetInput(ch);
 			}
-			In__Done_ = n == 1;
+			done = 1;
 		}
-	} else 	if (ch != EOF) {
-		ungetc(ch, stdin);
+	} else {
+		OBNC_UngetInput(ch);
 	}
+	return done;
+}
+
+
+void In__Int_(OBNC_INTEGER *x)
+{
+	In__Done_ = ReadInt(x);
 	if (In__Done_) {
 		inputConsumed = 1;
 	}
 }
 
 
-void In__Real_(OBNC_REAL *x)
+/*stores ch at text[i] and grows text as needed; returns zero if memory is exhausted*/
+static int Append(size_t i, int ch)
 {
-	int scanCount;
+	char *newText;
+	size_t newSize;
+	int done;
+
+	done = 1;
+	if (i >= textSize) {
+		newSize = (textSize > 0)? 2 * textSize: 64;
+		newText = realloc(text, newSize);
+		if (newText != NULL) {
+			text = newText;
+			textSize = newSize;
+		} else {
+			done = 0;
+		}
+	}
+	if (done) {
+		text[i] = (char) ch;
+	}
+	return done;
+}
+
+
+static int ReadReal(OBNC_REAL *x)
+{
+	static const OBNC_REAL powers[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	size_t i;
+	int ch, stored, digitCount, significantCount, fractionCount, exponent, expNeg, done;
+	OBNC_REAL mantissa, value;
+
+	done = 0;
+	do {
+		ch = GET();
+	} while (isspace(ch));
+	i = 0;
+	stored = 1;
+	digitCount = 0;
+	significantCount = 0;
+	fractionCount = 0;
+	mantissa = 0.0;
+	if ((ch == '-') || (ch == '+')) {
+		stored = Append(i, ch);
+		i++;
+		ch = GET();
+	}
+	while (isdigit(ch) && stored) {
+		stored = Append(i, ch);
+		i++;
+		digitCount++;
+		if ((significantCount > 0) || (ch != '0')) {
+			significantCount++;
+			mantissa = mantissa * 10.0 + (ch - '0');
+		}
+		ch = GET();
+	}
+	if ((ch == '.') && stored) {
+		stored = Append(i, ch);
+		i++;
+		ch = GET();
+		while (isdigit(ch) && stored) {
+			stored = Append(i, ch);
+			i++;
+			digitCount++;
+			fractionCount++;
+			if ((significantCount > 0) || (ch != '0')) {
+				significantCount++;
+				mantissa = mantissa * 10.0 + (ch - '0');
+			}
+			ch = GET();
+		}
+	}
+	exponent = 0;
+	done = digitCount > 0;
+	if (done && ((ch == 'E') || (ch == 'e')) && stored) {
+		stored = Append(i, ch);
+		i++;
+		ch = GET();
+		expNeg = ch == '-';
+		if (((ch == '-') || (ch == '+')) && stored) {
+			stored = Append(i, ch);
+			i++;
+			ch = GET();
+		}
+		done = isdigit(ch);
+		while (isdigit(ch) && stored) {
+			stored = Append(i, ch);
+			i++;
+			if (exponent < 10000) {
+				exponent = exponent * 10 + (ch - '0');
+			}
+			ch = GET();
+		}
+		if (expNeg) {
+			exponent = -exponent;
+		}
+	}
+	done = done && stored && Append(i, '\0');
+	if (done) {
+		exponent -= fractionCount;
+		if ((significantCount <= MAX_EXACT_DIGITS) && (exponent >= -MAX_EXACT_POWER) && (exponent <= MAX_EXACT_POWER)) {
+			/*both operands are exact, so the result is correctly rounded*/
+			value = (exponent >= 0)? mantissa * powers[exponent]: mantissa / powers[-exponent];
+			if (text[0] == '-') {
+				value = -value;
+			}
+		} else {
+			value = STRTOREAL(text, NULL);
+		}
+		*x = value;
+	}
+	OBNC_UngetInput(ch);
+	return done;
+}
+
 
-	scanCount = scanf("%" OBNC_REAL_MOD_R "f", x);
-	In__Done_ = scanCount == 1;
+void In__Real_(OBNC_REAL *x)
+{
+	In__Done_ = ReadReal(x);
 	if (In__Done_) {
 		inputConsumed = 1;
 	}
 }
 
 
+void In__Ints_(OBNC_INTEGER a[], OBNC_INTEGER aLen, OBNC_INTEGER n, OBNC_INTEGER *count)
+{
+	OBNC_INTEGER i;
+
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= aLen);
+
+	i = 0;
+	while ((i < n) && ReadInt(&a[i])) {
+		i++;
+	}
+	*count = i;
+	In__Done_ = i == n;
+	if (i > 0) {
+		inputConsumed = 1;
+	}
+}
+
+
+void In__Reals_(OBNC_REAL a[], OBNC_INTEGER aLen, OBNC_INTEGER n, OBNC_INTEGER *count)
+{
+	OBNC_INTEGER i;
+
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= aLen);
+
+	i = 0;
+	while ((i < n) && ReadReal(&a[i])) {
+		i++;
+	}
+	*count = i;
+	In__Done_ = i == n;
+	if (i > 0) {
+		inputConsumed = 1;
+	}
+}
+
+
 void In__String_(char str[], OBNC_INTEGER strLen)
 {
 	int ch, i, ord;
 
 	In__Done_ = 0;
 	do {
-		ch = getchar();
+		ch = GET();
 	} while (isspace(ch));
 	if (ch == '"') {
 		i = 0;
-		ch = getchar();
+		ch = GET();
 		while ((ch != EOF) && (ch != '"') && (ch != '\n') && (i < strLen)) {
 			str[i] = (char) ch;
 			i++;
-			ch = getchar();
+			ch = GET();
 		}
 		if ((ch == '"') && (i < strLen)) {
 			str[i] = '\0';
@@ -115,10 +307,10 @@ void In__String_(char str[], OBNC_INTEGER strLen)
 		}
 	} else if (isdigit(ch)) {
 		ord = ch - '0';
-		ch = getchar();
+		ch = GET();
 		while ((isdigit(ch) || ((ch >= 'A') && (ch <= 'F'))) && (ord < UCHAR_MAX)) {
 			ord = isdigit(ch)? ord * 16 + ch - '0': ord * 16 + 10 + ch - 'A';
-			ch = getchar();
+			ch = GET();
 		}
 		if ((ch == 'X') && (ord <= UCHAR_MAX) && (strLen >= 2)) {
 			str[0] = (char) ord;
@@ -140,7 +332,7 @@ void In__Name_(char name[], OBNC_INTEGER nameLen)
 	In__Done_ = 0;
 	n = 0;
 	do {
-		ch = getchar();
+		ch = GET();
 		n++;
 	} while (isspace(ch));
 	if (ch != EOF) {
@@ -148,7 +340,7 @@ void In__Name_(char name[], OBNC_INTEGER nameLen)
 		while ((i < nameLen) && (isgraph(ch) || ((unsigned char) ch >= 128))) {
 			name[i] = (char) ch;
 			i++;
-			ch = getchar();
+			ch = GET();
 			n++;
 		}
 		if (i < nameLen) {
@@ -172,13 +364,13 @@ void In__Line_(char line[], OBNC_INTEGER lineLen)
 	int i, ch;
 
 	i = 0;
-	ch = getchar();
+	ch = GET();
 	while ((ch != EOF) && (ch != '\n')) {
 		if (i < lineLen) {
 			line[i] = (char) ch;
 		}
 		i++;
-		ch = getchar();
+		ch = GET();
 	}
 	if ((i > 0) || (ch == '\n')) {
 		inputConsumed = 1;
@@ -19,10 +19,17 @@
 
 set -e
 
+long="1.$(printf '%0600d' 0)E0" #a real number with more than 600 characters
+
 input='a
 37
 37H
 3.14
+-1 0
+0FFH
+-2.5E-3 1.0E30
+0.1
+'"$long"'
 ""
 "foo bar"
 0X
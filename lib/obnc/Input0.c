@@ -13,12 +13,14 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 	#include <termios.h> /*POSIX*/
 	#include <unistd.h> /*POSIX*/
 #endif
-#include <fcntl.h> /*POSIX*/
 #include <sys/time.h> /*POSIX*/
 #include <assert.h>
 #include <errno.h>
 #include <limits.h>
+#include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #define LEN(arr) ((int) (sizeof (arr) / sizeof (arr)[0]))
@@ -62,6 +64,18 @@ void Input0__Read_(char *ch)
 }
 
 
+OBNC_INTEGER Input0__Wait_(OBNC_INTEGER timeout)
+{
+	HANDLE inputHandle;
+
+	inputHandle = GetStdHandle(STD_INPUT_HANDLE);
+	if ((inputHandle != NULL) && (inputHandle != INVALID_HANDLE_VALUE)) {
+		WaitForSingleObject(inputHandle, (timeout < 0)? INFINITE: (DWORD) timeout);
+	}
+	return Input0__Available_();
+}
+
+
 OBNC_INTEGER Input0__Time_(void)
 {
 	return GetTickCount();
@@ -79,105 +93,102 @@ OBNC_INTEGER Input0__Time_(void)
 	OBNC_INTEGER Input0__TimeUnit_ = 1000000000;
 #endif
 
-/*Keyboard buffer data structure*/
+/*Terminal state*/
+
+static int rawModeSet;
+static volatile sig_atomic_t rawModeActive;
+static struct termios savedTermios;
+
+/*restores the terminal settings; async-signal-safe*/
+static int ResetTerminal(void)
+{
+	int done = 1;
+
+	if (rawModeActive) {
+		rawModeActive = 0;
+		done = tcsetattr(STDIN_FILENO, TCSANOW, &savedTermios) == 0;
+	}
+	return done;
+}
 
-static char queue[256];
-static int queueFront, queueCount;
 
-static void Enqueue(char ch)
+static void RestoreTerminal(void)
 {
-	if (queueCount < LEN(queue)) {
-		queue[(queueFront + queueCount) % LEN(queue)] = ch;
-		queueCount++;
+	if (! ResetTerminal()) {
+		fprintf(stderr, "Input0: tcsetattr: %s\n", strerror(errno));
 	}
 }
 
 
-static void Dequeue(char *ch)
+static void HandleTerminationSignal(int sig)
 {
-	assert(queueCount > 0);
-	*ch = queue[queueFront];
-	queueFront = (queueFront + 1) % LEN(queue);
-	queueCount--;
+	(void) ResetTerminal();
+	signal(sig, SIG_DFL);
+	raise(sig);
 }
 
 
-OBNC_INTEGER Input0__Available_(void)
+static void CatchTerminationSignal(int sig)
 {
-	int result, error, oldf, status, ch;
-	struct termios oldt, newt;
+	if (signal(sig, HandleTerminationSignal) == SIG_IGN) {
+		signal(sig, SIG_IGN);
+	}
+}
 
-	result = 0;
-	error = tcgetattr(STDIN_FILENO, &oldt);
-	if (! error) {
-		newt = oldt;
-		newt.c_lflag &= ~(ICANON | ECHO);
-		error = tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-		if (! error) {
-			oldf = fcntl(STDIN_FILENO, F_GETFL, 0);
-			status = fcntl(STDIN_FILENO, F_SETFL, oldf | O_NONBLOCK);
-			if (status != -1) {
-				ch = getchar();
-				while (ch != EOF) {
-					Enqueue(ch);
-					ch = getchar();
-				}
-				status = fcntl(STDIN_FILENO, F_SETFL, oldf);
-				if (status != -1) {
-					error = tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-					if (! error) {
-						result = queueCount;
-					} else {
-						fprintf(stderr, "Input0.Available failed: tcsetattr: %s\n", strerror(errno));
-					}
+
+static void SetRawMode(const char procName[])
+{
+	struct termios t;
+
+	if (! rawModeSet) {
+		rawModeSet = 1;
+		if (isatty(STDIN_FILENO)) {
+			if (tcgetattr(STDIN_FILENO, &savedTermios) == 0) {
+				t = savedTermios;
+				t.c_lflag &= (tcflag_t) ~(ECHO | ICANON);
+				t.c_cc[VMIN] = 1;
+				t.c_cc[VTIME] = 0;
+				if (tcsetattr(STDIN_FILENO, TCSANOW, &t) == 0) {
+					rawModeActive = 1;
+					atexit(RestoreTerminal);
+					CatchTerminationSignal(SIGHUP);
+					CatchTerminationSignal(SIGINT);
+					CatchTerminationSignal(SIGQUIT);
+					CatchTerminationSignal(SIGTERM);
 				} else {
-					fprintf(stderr, "Input0.Available failed: fcntl: %s\n", strerror(errno));
+					fprintf(stderr, "Input0.%s failed: tcsetattr: %s\n", procName, strerror(errno));
 				}
 			} else {
-				fprintf(stderr, "Input0.Available failed: fcntl: %s\n", strerror(errno));
+				fprintf(stderr, "Input0.%s failed: tcgetattr: %s\n", procName, strerror(errno));
 			}
-		} else {
-			fprintf(stderr, "Input0.Available failed: tcsetattr: %s\n", strerror(errno));
 		}
-	} else {
-		fprintf(stderr, "Input0.Available failed: tcgetattr: %s\n", strerror(errno));
 	}
-	return result;
+}
+
+
+/*Input is read through the input buffer of the runtime so that it stays in order when module In is also used.*/
+
+OBNC_INTEGER Input0__Available_(void)
+{
+	SetRawMode("Available");
+	return OBNC_PollInput(0);
 }
 
 
 void Input0__Read_(char *ch)
 {
-	struct termios oldt, newt;
-	int error, inputChar;
+	int inputChar;
 
-	if (queueCount > 0) {
-		Dequeue(ch);
-	} else {
-		*ch = '\0';
-		error = tcgetattr(STDIN_FILENO, &oldt);
-		if (! error) {
-			newt = oldt;
-			newt.c_lflag &= (tcflag_t) ~(ECHO | ICANON);
-			newt.c_cc[VMIN] = 1;
-			error = tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-			if (! error) {
-				inputChar = getchar();
-				error = tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-				if (! error) {
-					if (inputChar != EOF) {
-						*ch = (char) inputChar;
-					}
-				} else {
-					fprintf(stderr, "Input0.Read failed: tcsetattr: %s\n", strerror(errno));
-				}
-			} else {
-				fprintf(stderr, "Input0.Read failed: tcsetattr: %s\n", strerror(errno));
-			}
-		} else {
-			fprintf(stderr, "Input0.Read failed: tcgetattr: %s\n", strerror(errno));
-		}
-	}
+	SetRawMode("Read");
+	inputChar = OBNC_GET_INPUT();
+	*ch = (inputChar != EOF)? (char) inputChar: '\0';
+}
+
+
+OBNC_INTEGER Input0__Wait_(OBNC_INTEGER timeout)
+{
+	SetRawMode("Wait");
+	return OBNC_PollInput((timeout < 0)? -1: ((timeout < INT_MAX)? (int) timeout: INT_MAX));
 }
 
 
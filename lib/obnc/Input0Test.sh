@@ -19,4 +19,4 @@
 
 set -e
 
-#TODO: find out how to send keys to Input0Test (which receives non-blocking input)
+printf "abc \$x" | ./Input0Test >/dev/null
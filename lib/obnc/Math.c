@@ -7,6 +7,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #include ".obnc/Math.h"
 #include <obnc/OBNC.h>
 #include <math.h>
+#include <string.h>
 
 #if OBNC_CONFIG_C_REAL_TYPE == OBNC_CONFIG_FLOAT
 	#define S(func) func ## f
@@ -16,6 +17,36 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 	#define S(func) func ## l
 #endif
 
+/*The array procedures process double values four at a time with GCC/Clang vector extensions. On x86-64 with glibc an AVX2 version is also compiled and selected at load time. Arguments outside the range of the vectorized approximations are passed to the scalar library function.*/
+
+#if OBNC_CONFIG_C_REAL_TYPE == OBNC_CONFIG_DOUBLE && defined __GNUC__
+	#define VECTORIZED 1
+
+	typedef double Vec __attribute__((vector_size(4 * sizeof (double))));
+	typedef unsigned long long Bits __attribute__((vector_size(4 * sizeof (long long))));
+
+	#if defined __x86_64__ && defined __GLIBC__ && defined __has_attribute
+		#if __has_attribute(target_clones)
+			#define CLONES __attribute__((target_clones("avx2", "default")))
+		#endif
+	#endif
+	#ifndef CLONES
+		#define CLONES
+	#endif
+
+	#if defined __SSE2__
+		#include <emmintrin.h>
+	#elif defined __aarch64__ && defined __ARM_NEON
+		#include <arm_neon.h>
+	#endif
+
+	#define INLINE static inline __attribute__((always_inline))
+	#define BLOCK_LEN 256 /*elements per block, a multiple of the vector length*/
+	#define SHIFT 6755399441055744.0 /*0x1.8p52; adding and subtracting it rounds to an integer*/
+#endif
+
+#define MIN(a, b) (((a) < (b))? (a): (b))
+
 OBNC_REAL Math__sqrt_(OBNC_REAL x)
 {
 	return S(sqrt)(x);
@@ -142,6 +173,311 @@ OBNC_REAL Math__arctanh_(OBNC_REAL x)
 }
 
 
+#ifdef VECTORIZED
+
+#define LOAD(v, a) memcpy(&(v), (a), sizeof (v))
+#define STORE(a, v) memcpy((a), &(v), sizeof (v))
+
+#define EXP_MIN -708.0
+#define EXP_MAX 709.0
+#define SIN_MAX 1.0e5
+
+/*all ones in the elements of x that are outside [lo, hi] or NaN*/
+#define OUT_OF_RANGE(x, lo, hi) (~((Bits) ((x) >= (lo)) & (Bits) ((x) <= (hi))))
+
+/*exp(x) for EXP_MIN <= x <= EXP_MAX: x = k ln 2 + r with |r| <= ln 2 / 2, exp(x) = 2^k exp(r)*/
+INLINE void Exp4(const double in[4], double out[4], Bits *outOfRange)
+{
+	const double log2e = 1.44269504088896338700e+00;
+	const double ln2Hi = 6.93147180369123816490e-01, ln2Lo = 1.90821492927058770002e-10;
+	Vec x, kd, k, r, p;
+	Bits ki;
+
+	LOAD(x, in);
+	kd = x * log2e + SHIFT;
+	k = kd - SHIFT;
+	r = (x - k * ln2Hi) - k * ln2Lo;
+	p = r * (1.0 / 6227020800.0) + 1.0 / 479001600.0;
+	p = p * r + 1.0 / 39916800.0;
+	p = p * r + 1.0 / 3628800.0;
+	p = p * r + 1.0 / 362880.0;
+	p = p * r + 1.0 / 40320.0;
+	p = p * r + 1.0 / 5040.0;
+	p = p * r + 1.0 / 720.0;
+	p = p * r + 1.0 / 120.0;
+	p = p * r + 1.0 / 24.0;
+	p = p * r + 1.0 / 6.0;
+	p = p * r + 0.5;
+	p = p * r + 1.0;
+	p = p * r + 1.0;
+	ki = (Bits) kd - (Bits) (kd - k); /*k in two's complement, kd - k being SHIFT*/
+	p *= (Vec) ((ki + 1023) << 52);
+	STORE(out, p);
+	*outOfRange |= OUT_OF_RANGE(x, EXP_MIN, EXP_MAX);
+}
+
+
+/*sin(x) for |x| <= SIN_MAX: x = n pi/2 + r with |r| <= pi/4, reduced with a three-part pi/2 (fdlibm constants and kernels)*/
+INLINE void Sin4(const double in[4], double out[4], Bits *outOfRange)
+{
+	const double twoOverPi = 6.36619772367581382433e-01;
+	const double pio2_1 = 1.57079632673412561417e+00, pio2_2 = 6.07710050630396597660e-11, pio2_2t = 2.02226624879595063154e-21;
+	Vec x, kd, n, r, z, s, c;
+	Bits q, odd;
+
+	LOAD(x, in);
+	kd = x * twoOverPi + SHIFT;
+	q = (Bits) kd; /*the low bits of the mantissa of kd are those of n*/
+	n = kd - SHIFT;
+	r = ((x - n * pio2_1) - n * pio2_2) - n * pio2_2t;
+	z = r * r;
+	s = z * 1.58969099521155010221e-10 - 2.50507602534068634195e-08;
+	s = s * z + 2.75573137070700676789e-06;
+	s = s * z - 1.98412698298579493134e-04;
+	s = s * z + 8.33333333332248946124e-03;
+	s = s * z - 1.66666666666666324348e-01;
+	s = r + r * z * s;
+	c = z * -1.13596475577881948265e-11 + 2.08757232129817482790e-09;
+	c = c * z - 2.75573143513906633035e-07;
+	c = c * z + 2.48015872894767294178e-05;
+	c = c * z - 1.38888888888741095749e-03;
+	c = c * z + 4.16666666666666019037e-02;
+	c = (1.0 - 0.5 * z) + z * z * c;
+	odd = -(q & 1);
+	q = ((odd & (Bits) c) | (~odd & (Bits) s)) ^ ((q & 2) << 62);
+	STORE(out, q);
+	*outOfRange |= OUT_OF_RANGE(x, -SIN_MAX, SIN_MAX);
+}
+
+
+/*ExpBlock(in, out) sets out[i] to exp(in[i]) for i = 0 to BLOCK_LEN - 1 and returns 0 if no argument was out of range*/
+CLONES static int ExpBlock(const double in[], double out[])
+{
+	Bits outOfRange = {0};
+	int i;
+
+	for (i = 0; i < BLOCK_LEN; i += 4) {
+		Exp4(in + i, out + i, &outOfRange);
+	}
+	return (outOfRange[0] | outOfRange[1] | outOfRange[2] | outOfRange[3]) != 0;
+}
+
+
+CLONES static int SinBlock(const double in[], double out[])
+{
+	Bits outOfRange = {0};
+	int i;
+
+	for (i = 0; i < BLOCK_LEN; i += 4) {
+		Sin4(in + i, out + i, &outOfRange);
+	}
+	return (outOfRange[0] | outOfRange[1] | outOfRange[2] | outOfRange[3]) != 0;
+}
+
+
+/*applies the block function to x[0] .. x[n - 1] and recomputes the results for arguments outside [lo, hi] with the scalar function; x and y may be the same array*/
+static void Apply(int (*block)(const double in[], double out[]), double (*scalar)(double), double lo, double hi, const double x[], double y[], OBNC_INTEGER n)
+{
+	double in[BLOCK_LEN], out[BLOCK_LEN];
+	const double *src;
+	OBNC_INTEGER i;
+	int len, j;
+
+	for (i = 0; i < n; i += len) {
+		len = (int) MIN(n - i, BLOCK_LEN);
+		src = x + i;
+		if (len < BLOCK_LEN) {
+			memcpy(in, src, (size_t) len * sizeof in[0]);
+			memset(in + len, 0, (size_t) (BLOCK_LEN - len) * sizeof in[0]);
+			src = in;
+		}
+		if (block(src, out)) {
+			for (j = 0; j < len; j++) {
+				if (! ((src[j] >= lo) && (src[j] <= hi))) {
+					out[j] = scalar(src[j]);
+				}
+			}
+		}
+		memcpy(y + i, out, (size_t) len * sizeof out[0]);
+	}
+}
+
+#endif
+
+void Math__sqrtArray_(const OBNC_REAL x[], OBNC_INTEGER xLen, OBNC_REAL y[], OBNC_INTEGER yLen, OBNC_INTEGER n)
+{
+	OBNC_INTEGER i;
+
+	OBNC_C_ASSERT((n >= 0) && (n <= xLen) && (n <= yLen));
+	i = 0;
+#if defined VECTORIZED && defined __SSE2__
+	for (; i + 2 <= n; i += 2) {
+		_mm_storeu_pd(y + i, _mm_sqrt_pd(_mm_loadu_pd(x + i)));
+	}
+#elif defined VECTORIZED && defined __aarch64__ && defined __ARM_NEON
+	for (; i + 2 <= n; i += 2) {
+		vst1q_f64(y + i, vsqrtq_f64(vld1q_f64(x + i)));
+	}
+#endif
+	for (; i < n; i++) {
+		y[i] = S(sqrt)(x[i]);
+	}
+}
+
+
+void Math__expArray_(const OBNC_REAL x[], OBNC_INTEGER xLen, OBNC_REAL y[], OBNC_INTEGER yLen, OBNC_INTEGER n)
+{
+	OBNC_C_ASSERT((n >= 0) && (n <= xLen) && (n <= yLen));
+#ifdef VECTORIZED
+	Apply(ExpBlock, exp, EXP_MIN, EXP_MAX, x, y, n);
+#else
+	{
+		OBNC_INTEGER i;
+
+		for (i = 0; i < n; i++) {
+			y[i] = S(exp)(x[i]);
+		}
+	}
+#endif
+}
+
+
+void Math__sinArray_(const OBNC_REAL x[], OBNC_INTEGER xLen, OBNC_REAL y[], OBNC_INTEGER yLen, OBNC_INTEGER n)
+{
+	OBNC_C_ASSERT((n >= 0) && (n <= xLen) && (n <= yLen));
+#ifdef VECTORIZED
+	Apply(SinBlock, sin, -SIN_MAX, SIN_MAX, x, y, n);
+#else
+	{
+		OBNC_INTEGER i;
+
+		for (i = 0; i < n; i++) {
+			y[i] = S(sin)(x[i]);
+		}
+	}
+#endif
+}
+
+
+#ifdef VECTORIZED
+
+CLONES static void Axpy(double a, const double x[], double y[], OBNC_INTEGER n)
+{
+	Vec u, v;
+	OBNC_INTEGER i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		LOAD(u, x + i);
+		LOAD(v, y + i);
+		v += a * u;
+		STORE(y + i, v);
+	}
+	for (; i < n; i++) {
+		y[i] = a * x[i] + y[i];
+	}
+}
+
+
+CLONES static double Dot(const double x[], const double y[], OBNC_INTEGER n)
+{
+	Vec acc0 = {0.0}, acc1 = {0.0}, u0, u1, v0, v1;
+	double result;
+	OBNC_INTEGER i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		LOAD(u0, x + i);
+		LOAD(u1, x + i + 4);
+		LOAD(v0, y + i);
+		LOAD(v1, y + i + 4);
+		acc0 += u0 * v0;
+		acc1 += u1 * v1;
+	}
+	acc0 += acc1;
+	result = (acc0[0] + acc0[1]) + (acc0[2] + acc0[3]);
+	for (; i < n; i++) {
+		result += x[i] * y[i];
+	}
+	return result;
+}
+
+
+CLONES static double Sum(const double x[], OBNC_INTEGER n)
+{
+	Vec acc0 = {0.0}, acc1 = {0.0}, u0, u1;
+	double result;
+	OBNC_INTEGER i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		LOAD(u0, x + i);
+		LOAD(u1, x + i + 4);
+		acc0 += u0;
+		acc1 += u1;
+	}
+	acc0 += acc1;
+	result = (acc0[0] + acc0[1]) + (acc0[2] + acc0[3]);
+	for (; i < n; i++) {
+		result += x[i];
+	}
+	return result;
+}
+
+#endif
+
+void Math__axpy_(OBNC_REAL a, const OBNC_REAL x[], OBNC_INTEGER xLen, OBNC_REAL y[], OBNC_INTEGER yLen, OBNC_INTEGER n)
+{
+	OBNC_C_ASSERT((n >= 0) && (n <= xLen) && (n <= yLen));
+#ifdef VECTORIZED
+	Axpy(a, x, y, n);
+#else
+	{
+		OBNC_INTEGER i;
+
+		for (i = 0; i < n; i++) {
+			y[i] = a * x[i] + y[i];
+		}
+	}
+#endif
+}
+
+
+OBNC_REAL Math__dot_(const OBNC_REAL x[], OBNC_INTEGER xLen, const OBNC_REAL y[], OBNC_INTEGER yLen, OBNC_INTEGER n)
+{
+	OBNC_C_ASSERT((n >= 0) && (n <= xLen) && (n <= yLen));
+#ifdef VECTORIZED
+	return Dot(x, y, n);
+#else
+	{
+		OBNC_REAL result = 0.0;
+		OBNC_INTEGER i;
+
+		for (i = 0; i < n; i++) {
+			result += x[i] * y[i];
+		}
+		return result;
+	}
+#endif
+}
+
+
+OBNC_REAL Math__sum_(const OBNC_REAL x[], OBNC_INTEGER xLen, OBNC_INTEGER n)
+{
+	OBNC_C_ASSERT((n >= 0) && (n <= xLen));
+#ifdef VECTORIZED
+	return Sum(x, n);
+#else
+	{
+		OBNC_REAL result = 0.0;
+		OBNC_INTEGER i;
+
+		for (i = 0; i < n; i++) {
+			result += x[i];
+		}
+		return result;
+	}
+#endif
+}
+
+
 void Math__Init(void)
 {
 	/*do nothing*/
@@ -4,26 +4,64 @@ This Source Code Form is subject to the terms of the Mozilla Public
 License, v. 2.0. If a copy of the MPL was not distributed with this
 file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 
+#if defined __linux__ && ! defined _GNU_SOURCE
+	#define _GNU_SOURCE /*dl_iterate_phdr*/
+#endif
+
 #include "OBNC.h"
 #if ! (OBNC_CONFIG_NO_GC || OBNC_CONFIG_TARGET_EMB)
 	#include <gc/gc.h>
 #endif
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#if ! OBNC_CONFIG_TARGET_EMB
+	#ifdef _WIN32
+		#include <io.h>
+	#else
+		#include <poll.h> /*POSIX*/
+		#include <unistd.h> /*POSIX*/
+	#endif
+#endif
+#if ! OBNC_CONFIG_TARGET_EMB && defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L && ! defined __STDC_NO_ATOMICS__
+	#include <stdatomic.h>
+	#define HAVE_ATOMICS 1
+#endif
+#if defined HAVE_ATOMICS && defined __linux__ && defined __GLIBC__
+	#include <execinfo.h>
+	#include <link.h>
+	#include <signal.h>
+	#include <stdint.h>
+	#include <sys/time.h>
+	#include <unistd.h>
+	#define HAVE_PROFILER 1
+#endif
 
 #define UNUSED(x) (void) (x)
 
 int OBNC_argc;
 char **OBNC_argv;
-OBNC_TrapHandler OBNC_handleTrap;
+#if ! OBNC_CONFIG_TARGET_EMB
+	OBNC_THREAD_LOCAL jmp_buf *OBNC_trapRecovery;
+#endif
+
+#ifdef HAVE_ATOMICS
+	static atomic_long trapCounts[OBNC_EXCEPTION_COUNT + 1]; /*indexed by exception code*/
+#else
+	static long trapCounts[OBNC_EXCEPTION_COUNT + 1];
+#endif
 
 void OBNC_ExitTrap(void)
 {
 #if OBNC_CONFIG_TARGET_EMB
 	while (1);
 #else
+	if (OBNC_trapRecovery != NULL) {
+		longjmp(*OBNC_trapRecovery, 1);
+	}
 	exit(EXIT_FAILURE);
 #endif
 }
@@ -76,14 +114,273 @@ static void ExitTrapWithMessage(OBNC_INTEGER exception, const char file[], OBNC_
 }
 
 
+OBNC_THREAD_LOCAL OBNC_TrapHandler OBNC_handleTrap = ExitTrapWithMessage; /*each thread starts with the default handler*/
+
+void OBNC_Trap(OBNC_INTEGER exception, const char file[], OBNC_INTEGER fileLen, OBNC_INTEGER line)
+{
+	if ((exception > 0) && (exception <= OBNC_EXCEPTION_COUNT)) {
+#ifdef HAVE_ATOMICS
+		atomic_fetch_add_explicit(&trapCounts[exception], 1, memory_order_relaxed);
+#else
+		trapCounts[exception]++;
+#endif
+	}
+	OBNC_handleTrap(exception, file, fileLen, line);
+	OBNC_ExitTrap();
+}
+
+
+OBNC_INTEGER OBNC_TrapCount(OBNC_INTEGER exception)
+{
+	long result;
+	int i;
+
+	OBNC_C_ASSERT((exception >= 0) && (exception <= OBNC_EXCEPTION_COUNT));
+	result = 0;
+	for (i = 1; i <= OBNC_EXCEPTION_COUNT; i++) {
+		if ((exception == 0) || (exception == i)) {
+#ifdef HAVE_ATOMICS
+			result += atomic_load_explicit(&trapCounts[i], memory_order_relaxed);
+#else
+			result += trapCounts[i];
+#endif
+		}
+	}
+	return (OBNC_INTEGER) result;
+}
+
+
+#ifdef HAVE_PROFILER
+
+/*Sampling profiler, enabled by setting the environment variable OBNC_PROFILE to an output filename. SIGPROF is raised every millisecond of CPU time consumed by the program and the signal handler records the call stack of the interrupted thread in a hash table. At exit the stacks are written in folded format (one line per stack, root first, followed by the sample count) with each frame given as object file plus offset, to be symbolized offline by obnc-profile.*/
+
+#define PROFILE_INTERVAL 1000 /*microseconds*/
+#define PROFILE_MAX_DEPTH 64
+#define PROFILE_TABLE_LEN 4096 /*power of two*/
+#define PROFILE_SKIPPED_FRAMES 2 /*signal handler and signal trampoline*/
+#define PROFILE_MAX_SEGMENTS 256
+
+typedef struct {
+	atomic_ulong key; /*hash of the stack, 0 if unused*/
+	atomic_int ready; /*pcs and depth are set*/
+	int depth;
+	void *pcs[PROFILE_MAX_DEPTH]; /*leaf first*/
+	atomic_long count;
+} ProfileEntry;
+
+typedef struct {
+	uintptr_t start, end, base;
+	const char *name;
+} Segment;
+
+static ProfileEntry *profileTable;
+static atomic_long profileDropped;
+static const char *profileFile;
+static Segment segments[PROFILE_MAX_SEGMENTS];
+static int segmentCount;
+
+static unsigned long StackHash(void *const pcs[], int n)
+{
+	unsigned long h;
+	int i;
+
+	h = 14695981039346656037ul;
+	for (i = 0; i < n; i++) {
+		h = (h ^ (unsigned long) (uintptr_t) pcs[i]) * 1099511628211ul;
+	}
+	return (h != 0)? h: 1;
+}
+
+
+static void Sample(int signum)
+{
+	void *pcs[PROFILE_MAX_DEPTH + PROFILE_SKIPPED_FRAMES];
+	void *const *stack;
+	ProfileEntry *e;
+	unsigned long h, key;
+	int savedErrno, n, i, probes, recorded;
+
+	(void) signum;
+	savedErrno = errno;
+	n = backtrace(pcs, (int) (sizeof pcs / sizeof pcs[0])) - PROFILE_SKIPPED_FRAMES;
+	if (n > 0) {
+		stack = pcs + PROFILE_SKIPPED_FRAMES;
+		h = StackHash(stack, n);
+		i = (int) (h & (PROFILE_TABLE_LEN - 1));
+		recorded = 0;
+		/*linear probing; a slot which is being filled in by another thread is skipped so that the handler never waits*/
+		for (probes = 0; (probes < PROFILE_TABLE_LEN) && ! recorded; probes++) {
+			e = &profileTable[i];
+			key = atomic_load_explicit(&e->key, memory_order_acquire);
+			if (key == 0) {
+				if (atomic_compare_exchange_strong(&e->key, &key, h)) {
+					memcpy(e->pcs, stack, (size_t) n * sizeof stack[0]);
+					e->depth = n;
+					atomic_store_explicit(&e->count, 1, memory_order_relaxed);
+					atomic_store_explicit(&e->ready, 1, memory_order_release);
+					recorded = 1;
+				}
+			}
+			if (! recorded && (key == h) && atomic_load_explicit(&e->ready, memory_order_acquire)
+					&& (e->depth == n) && (memcmp(e->pcs, stack, (size_t) n * sizeof stack[0]) == 0)) {
+				atomic_fetch_add_explicit(&e->count, 1, memory_order_relaxed);
+				recorded = 1;
+			}
+			i = (i + 1) & (PROFILE_TABLE_LEN - 1);
+		}
+		if (! recorded) {
+			atomic_fetch_add_explicit(&profileDropped, 1, memory_order_relaxed);
+		}
+	}
+	errno = savedErrno;
+}
+
+
+static int AddSegments(struct dl_phdr_info *info, size_t size, void *data)
+{
+	static char exe[4096];
+	ssize_t len;
+	const char *name;
+	int i;
+
+	(void) size;
+	(void) data;
+	name = info->dlpi_name;
+	if ((name == NULL) || (name[0] == '\0')) {
+		/*main program*/
+		len = readlink("/proc/self/exe", exe, sizeof exe - 1);
+		if (len > 0) {
+			exe[len] = '\0';
+			name = exe;
+		} else {
+			name = "?";
+		}
+	}
+	for (i = 0; (i < info->dlpi_phnum) && (segmentCount < PROFILE_MAX_SEGMENTS); i++) {
+		if ((info->dlpi_phdr[i].p_type == PT_LOAD) && (info->dlpi_phdr[i].p_flags & PF_X)) {
+			segments[segmentCount].base = (uintptr_t) info->dlpi_addr;
+			segments[segmentCount].start = (uintptr_t) info->dlpi_addr + info->dlpi_phdr[i].p_vaddr;
+			segments[segmentCount].end = segments[segmentCount].start + info->dlpi_phdr[i].p_memsz;
+			segments[segmentCount].name = name;
+			segmentCount++;
+		}
+	}
+	return 0;
+}
+
+
+/*writes pc as an object file and an address that addr2line accepts for that file*/
+static void WriteFrame(uintptr_t pc, FILE *f)
+{
+	int i;
+
+	i = 0;
+	while ((i < segmentCount) && ! ((pc >= segments[i].start) && (pc < segments[i].end))) {
+		i++;
+	}
+	if (i < segmentCount) {
+		fprintf(f, "%s+0x%lx", segments[i].name, (unsigned long) (pc - segments[i].base));
+	} else {
+		fprintf(f, "0x%lx", (unsigned long) pc);
+	}
+}
+
+
+static void WriteProfile(void)
+{
+	struct itimerval timer;
+	ProfileEntry *e;
+	FILE *f;
+	int i, j;
+
+	memset(&timer, 0, sizeof timer);
+	setitimer(ITIMER_PROF, &timer, NULL);
+	signal(SIGPROF, SIG_IGN);
+
+	dl_iterate_phdr(AddSegments, NULL);
+	f = fopen(profileFile, "w");
+	if (f != NULL) {
+		for (i = 0; i < PROFILE_TABLE_LEN; i++) {
+			e = &profileTable[i];
+			if (atomic_load(&e->ready)) {
+				for (j = e->depth - 1; j >= 0; j--) {
+					/*return addresses point after the call instruction; only the leaf frame is the interrupted instruction itself*/
+					WriteFrame((uintptr_t) e->pcs[j] - ((j > 0)? 1: 0), f);
+					putc((j > 0)? ';': ' ', f);
+				}
+				fprintf(f, "%ld\n", atomic_load(&e->count));
+			}
+		}
+		if (fclose(f) != 0) {
+			fprintf(stderr, "OBNC: writing profile failed: %s: %s\n", profileFile, strerror(errno));
+		}
+	} else {
+		fprintf(stderr, "OBNC: opening profile failed: %s: %s\n", profileFile, strerror(errno));
+	}
+	if (atomic_load(&profileDropped) > 0) {
+		fprintf(stderr, "OBNC: profile table full, %ld samples dropped\n", atomic_load(&profileDropped));
+	}
+}
+
+
+static void StartProfiler(const char file[])
+{
+	struct sigaction action;
+	struct itimerval timer;
+	void *pcs[1];
+
+	profileTable = calloc(PROFILE_TABLE_LEN, sizeof profileTable[0]);
+	if (profileTable != NULL) {
+		profileFile = file;
+		backtrace(pcs, 1); /*the first call loads the unwinder, which is not safe to do in a signal handler*/
+		memset(&action, 0, sizeof action);
+		action.sa_handler = Sample;
+		action.sa_flags = SA_RESTART;
+		sigemptyset(&action.sa_mask);
+		if ((sigaction(SIGPROF, &action, NULL) == 0) && (atexit(WriteProfile) == 0)) {
+			timer.it_interval.tv_sec = 0;
+			timer.it_interval.tv_usec = PROFILE_INTERVAL;
+			timer.it_value = timer.it_interval;
+			if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+				fprintf(stderr, "OBNC: starting profiler failed: %s\n", strerror(errno));
+			}
+		} else {
+			fprintf(stderr, "OBNC: starting profiler failed: %s\n", strerror(errno));
+		}
+	} else {
+		fprintf(stderr, "OBNC: starting profiler failed: out of memory\n");
+	}
+}
+
+#endif
+
+#if ! OBNC_CONFIG_TARGET_EMB
+	static char stdoutBuffer[65536];
+#endif
+
 void OBNC_Init(int argc, char *argv[])
 {
+#ifdef HAVE_PROFILER
+	const char *profile;
+#endif
+
 	OBNC_argc = argc;
 	OBNC_argv = argv;
-	OBNC_handleTrap = ExitTrapWithMessage;
 #if ! (OBNC_CONFIG_NO_GC || OBNC_CONFIG_TARGET_EMB)
 	GC_INIT();
 #endif
+#if ! OBNC_CONFIG_TARGET_EMB
+	/*write standard output in large blocks unless it is a terminal, where an interactive user should see it line by line; setvbuf must be called before any output, i.e. before the modules are initialized*/
+	if (! isatty(fileno(stdout))) {
+		setvbuf(stdout, stdoutBuffer, _IOFBF, sizeof stdoutBuffer);
+	}
+#endif
+#ifdef HAVE_PROFILER
+	profile = getenv("OBNC_PROFILE");
+	if ((profile != NULL) && (profile[0] != '\0')) {
+		StartProfiler(profile);
+	}
+#endif
 }
 
 
@@ -145,7 +442,7 @@ void OBNC_Init(int argc, char *argv[])
 OBNC_INTEGER OBNC_It1(OBNC_INTEGER i, OBNC_INTEGER n, const char file[], int line)
 {
 	if ((i < 0) || (i >= n)) {
-		OBNC_handleTrap(OBNC_ARRAY_INDEX_EXCEPTION, file, strlen(file) + 1, line);
+		OBNC_Trap(OBNC_ARRAY_INDEX_EXCEPTION, file, strlen(file) + 1, line);
 	}
 	return i;
 }
@@ -159,46 +456,50 @@ static OBNC_INTEGER Abs(OBNC_INTEGER x)
 
 void OBNC_WriteInt(OBNC_INTEGER x, OBNC_INTEGER n, FILE *f)
 {
-	int neg, i;
+	static const char blanks[] = "                ";
 	char buf[(CHAR_BIT * sizeof (OBNC_INTEGER) / 3) + 3];
+	OBNC_INTEGER padding;
+	int neg, i, len;
 
+	/*convert into buf from the right and write the result with a single call*/
 	neg = x < 0;
-	i = 0;
+	i = (int) sizeof (buf);
 	do {
-		OBNC_C_ASSERT(i < (int) (sizeof (buf) / sizeof (buf[0])));
+		OBNC_C_ASSERT(i > 1);
+		i--;
 		buf[i] = '0' + Abs(x % 10);
 		x = x / 10;
-		i++;
 	} while (x != 0);
-	while (n > i + !! neg) {
-		putc(' ', f);
-		n--;
-	}
 	if (neg) {
-		putc('-', f);
-	}
-	do {
 		i--;
-		putc(buf[i], f);
-	} while (i > 0);
+		buf[i] = '-';
+	}
+	len = (int) sizeof (buf) - i;
+	while (n > len) {
+		padding = n - len;
+		if (padding > (OBNC_INTEGER) sizeof (blanks) - 1) {
+			padding = (OBNC_INTEGER) sizeof (blanks) - 1;
+		}
+		fwrite(blanks, 1, (size_t) padding, f);
+		n -= padding;
+	}
+	fwrite(buf + i, 1, (size_t) len, f);
 }
 
 
 void OBNC_WriteHex(unsigned OBNC_INTEGER n, FILE *f)
 {
 	unsigned OBNC_INTEGER d;
-	char digits[2 * sizeof n];
+	char buf[2 * sizeof n + 1];
 	int i;
 
-	putc(' ', f);
-	for (i = 0; i < (int) sizeof (digits); i++) {
+	buf[0] = ' ';
+	for (i = (int) sizeof (buf) - 1; i > 0; i--) {
 		d = n % 16;
-		digits[i] = (d >= 10)? 'A' + d - 10: '0' + d;
+		buf[i] = (d >= 10)? 'A' + d - 10: '0' + d;
 		n = n / 16;
 	}
-	for (i = (int) sizeof (digits) - 1; i >= 0; i--) {
-		putc(digits[i], f);
-	}
+	fwrite(buf, 1, sizeof (buf), f);
 }
 
 
@@ -212,6 +513,89 @@ void OBNC_Exit(int status)
 }
 
 
+#if ! OBNC_CONFIG_TARGET_EMB
+
+#define INPUT_MASK (OBNC_INPUT_BUFFER_SIZE - 1)
+
+unsigned char OBNC_inputBuffer[OBNC_INPUT_BUFFER_SIZE];
+unsigned int OBNC_inputFront, OBNC_inputCount;
+static int inputEnded;
+
+/*reads into the free space of the input buffer up to the end of the array; blocks until some input is available*/
+static void FillInputBuffer(void)
+{
+	unsigned int front, back, n;
+	long count;
+
+	assert(OBNC_inputCount < OBNC_INPUT_BUFFER_SIZE);
+	front = OBNC_inputFront & INPUT_MASK;
+	back = (OBNC_inputFront + OBNC_inputCount) & INPUT_MASK;
+	n = ((OBNC_inputCount == 0) || (back > front))? OBNC_INPUT_BUFFER_SIZE - back: front - back;
+	do {
+		count = read(fileno(stdin), OBNC_inputBuffer + back, n);
+	} while ((count < 0) && (errno == EINTR));
+	if (count > 0) {
+		OBNC_inputCount += (unsigned int) count;
+	} else {
+		if (count < 0) {
+			fprintf(stderr, "OBNC: reading standard input failed: %s\n", strerror(errno));
+		}
+		inputEnded = 1;
+	}
+}
+
+
+int OBNC_ReadInput(void)
+{
+	int result = EOF;
+
+	if ((OBNC_inputCount == 0) && ! inputEnded) {
+		FillInputBuffer();
+	}
+	if (OBNC_inputCount > 0) {
+		result = OBNC_GET_INPUT();
+	}
+	return result;
+}
+
+
+void OBNC_UngetInput(int ch)
+{
+	if ((ch != EOF) && (OBNC_inputCount < OBNC_INPUT_BUFFER_SIZE)) {
+		OBNC_inputFront--;
+		OBNC_inputBuffer[OBNC_inputFront & INPUT_MASK] = (unsigned char) ch;
+		OBNC_inputCount++;
+	}
+}
+
+
+#ifndef _WIN32
+
+int OBNC_PollInput(int timeout)
+{
+	struct pollfd pfd;
+	int ready;
+
+	if (! inputEnded && (OBNC_inputCount < OBNC_INPUT_BUFFER_SIZE)) {
+		pfd.fd = fileno(stdin);
+		pfd.events = POLLIN;
+		do {
+			ready = poll(&pfd, 1, (OBNC_inputCount > 0)? 0: timeout);
+		} while ((ready < 0) && (errno == EINTR));
+		if (ready > 0) {
+			FillInputBuffer();
+		} else if (ready < 0) {
+			fprintf(stderr, "OBNC: polling standard input failed: %s\n", strerror(errno));
+		}
+	}
+	return (int) OBNC_inputCount;
+}
+
+#endif
+
+#endif
+
+
 int OBNC_Cmp(const char s[], OBNC_INTEGER sLen, const char t[], OBNC_INTEGER tLen)
 {
 	return strncmp(s, t, (sLen < tLen)? sLen: tLen);
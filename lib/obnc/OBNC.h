@@ -14,6 +14,9 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if ! OBNC_CONFIG_TARGET_EMB
+	#include <setjmp.h>
+#endif
 
 #if OBNC_CONFIG_TARGET_EMB
 	#define OBNC_CFILE ""
@@ -23,6 +26,20 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 	#define OBNC_OBNFILE OBERON_SOURCE_FILENAME
 #endif
 
+/*Storage class of per-thread runtime state*/
+
+#if OBNC_CONFIG_TARGET_EMB
+	#define OBNC_THREAD_LOCAL
+#elif defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L
+	#define OBNC_THREAD_LOCAL _Thread_local
+#elif defined __GNUC__
+	#define OBNC_THREAD_LOCAL __thread
+#elif defined _MSC_VER
+	#define OBNC_THREAD_LOCAL __declspec(thread)
+#else
+	#define OBNC_THREAD_LOCAL
+#endif
+
 /*Run-time exceptions*/
 
 #define OBNC_ARRAY_ASSIGNMENT_EXCEPTION 1
@@ -34,6 +51,8 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #define OBNC_CASE_EXP_MATCH_EXCEPTION 7
 #define OBNC_ASSERT_STATEMENT_EXCEPTION 8
 
+#define OBNC_EXCEPTION_COUNT 8
+
 /*Memory allocation kinds*/
 
 #define OBNC_REGULAR_ALLOC 0
@@ -166,15 +185,13 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 		if (strcmp(#b, "0") == 0) { \
 			OBNC_Exit(EXIT_FAILURE); \
 		} else { \
-			OBNC_handleTrap(OBNC_ASSERT_STATEMENT_EXCEPTION, (oberonFile), strlen(oberonFile) + 1, (line)); \
-			OBNC_ExitTrap(); \
+			OBNC_Trap(OBNC_ASSERT_STATEMENT_EXCEPTION, (oberonFile), strlen(oberonFile) + 1, (line)); \
 		} \
 	}
 
 #define OBNC_C_ASSERT(b) \
 	if (! (b)) { \
-		OBNC_handleTrap(OBNC_ASSERT_STATEMENT_EXCEPTION, OBNC_CFILE, sizeof OBNC_CFILE, __LINE__); \
-		OBNC_ExitTrap(); \
+		OBNC_Trap(OBNC_ASSERT_STATEMENT_EXCEPTION, OBNC_CFILE, sizeof OBNC_CFILE, __LINE__); \
 	}
 
 #define OBNC_PACK(x, n) (x) = OBNC_REAL_SUFFIX(ldexp)(x, n)
@@ -228,7 +245,10 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 
 /*Operators*/
 
-#define OBNC_CMP(arr1, len1, arr2, len2) (strncmp((arr1), (arr2), ((len1) < (len2))? (len1): (len2)))
+#define OBNC_CMP(arr1, len1, arr2, len2) \
+	(((arr1)[0] != (arr2)[0]) \
+		? (int) (unsigned char) (arr1)[0] - (int) (unsigned char) (arr2)[0] \
+		: strncmp((arr1), (arr2), ((len1) < (len2))? (len1): (len2)))
 
 #define OBNC_IS(var, td, typeID, extLevel) (((var) != NULL) && ((extLevel) < (td)->nids) && ((td)->ids[extLevel] == (typeID)))
 
@@ -247,51 +267,94 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 
 #define OBNC_COPY_ARRAY(src, dst, n) memcpy(dst, src, (size_t) (n) * sizeof (src)[0])
 
-/*Traps*/
+/*Traps; each family of checks can be disabled with a constant OBNC_CONFIG_NO_<FAMILY>_CHECKS, which obnc-compile --checks defines in the generated C file*/
+
+#if OBNC_CONFIG_NO_INDEX_CHECKS
+
+#define OBNC_IT(index, length, line) (index)
+
+#define OBNC_IT1(index, length, line) (index)
+
+#else
 
 #define OBNC_IT(index, length, line) \
 	(((unsigned OBNC_INTEGER) (index) < (unsigned OBNC_INTEGER) (length)) \
 		? (index) \
-		: (OBNC_handleTrap(OBNC_ARRAY_INDEX_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), OBNC_ExitTrap(), (index)))
+		: (OBNC_Trap(OBNC_ARRAY_INDEX_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), (index)))
 
 #define OBNC_IT1(index, length, line) (OBNC_It1((index), (length), OBNC_OBNFILE, (line)))
 
+#endif
+
+#if OBNC_CONFIG_NO_GUARD_CHECKS
+
+#define OBNC_RTT(recPtr, td, typeID, extLevel, line) (recPtr)
+
+#define OBNC_PTT(ptrPtr, td, typeID, extLevel, line) (ptrPtr)
+
+#else
+
 #define OBNC_RTT(recPtr, td, typeID, extLevel, line) \
 	(OBNC_IS((recPtr), (td), (typeID), (extLevel)) \
 		? (recPtr) \
-		: (OBNC_handleTrap(OBNC_TYPE_GUARD_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), OBNC_ExitTrap(), (recPtr)))
+		: (OBNC_Trap(OBNC_TYPE_GUARD_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), (recPtr)))
 
 #define OBNC_PTT(ptrPtr, td, typeID, extLevel, line) \
 	((OBNC_IS(*(ptrPtr), (td), (typeID), (extLevel))) \
 		? (ptrPtr) \
-		: (OBNC_handleTrap(OBNC_TYPE_GUARD_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), OBNC_ExitTrap(), (ptrPtr)))
+		: (OBNC_Trap(OBNC_TYPE_GUARD_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), (ptrPtr)))
+
+#endif
+
+#if OBNC_CONFIG_NO_ASSIGNMENT_CHECKS
+
+#define OBNC_AAT(sourceLen, targetLen, line)
+
+#define OBNC_RAT(srcTD, dstTD, line)
+
+#else
 
 #define OBNC_AAT(sourceLen, targetLen, line) \
 	if (sourceLen > targetLen) { \
-		OBNC_handleTrap(OBNC_ARRAY_ASSIGNMENT_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)); \
-		OBNC_ExitTrap(); \
+		OBNC_Trap(OBNC_ARRAY_ASSIGNMENT_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)); \
 	}
 
 #define OBNC_RAT(srcTD, dstTD, line) \
 	if (! (((srcTD)->nids >= (dstTD)->nids) \
 			&& ((srcTD)->ids[(dstTD)->nids - 1] == (dstTD)->ids[(dstTD)->nids - 1]))) { \
-		OBNC_handleTrap(OBNC_RECORD_ASSIGNMENT_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)); \
-		OBNC_ExitTrap(); \
+		OBNC_Trap(OBNC_RECORD_ASSIGNMENT_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)); \
 	}
 
+#endif
+
+#if OBNC_CONFIG_NO_POINTER_CHECKS
+
+#define OBNC_PT(ptr, line) (ptr)
+
+#else
+
 #define OBNC_PT(ptr, line) \
 	(((ptr) != NULL)? \
 		(ptr): \
-		(OBNC_handleTrap(OBNC_POINTER_DEREFERENCE_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), OBNC_ExitTrap(), (ptr)))
+		(OBNC_Trap(OBNC_POINTER_DEREFERENCE_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), (ptr)))
+
+#endif
+
+#if OBNC_CONFIG_NO_CALL_CHECKS
+
+#define OBNC_PCT(ptr, line) (ptr)
+
+#else
 
 #define OBNC_PCT(ptr, line) \
 	(((ptr) != NULL)? \
 		(ptr): \
-		(OBNC_handleTrap(OBNC_PROCEDURE_CALL_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), OBNC_ExitTrap(), (ptr)))
+		(OBNC_Trap(OBNC_PROCEDURE_CALL_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)), (ptr)))
+
+#endif
 
 #define OBNC_CT(line) \
-	OBNC_handleTrap(OBNC_CASE_EXP_MATCH_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line)); \
-	OBNC_ExitTrap()
+	OBNC_Trap(OBNC_CASE_EXP_MATCH_EXCEPTION, OBNC_OBNFILE, sizeof OBNC_OBNFILE, (line))
 
 typedef struct {
 	const int *const *ids; /*basetype IDs*/
@@ -302,16 +365,51 @@ typedef void (*OBNC_TrapHandler)(OBNC_INTEGER exception, const char file[], OBNC
 
 extern int OBNC_argc;
 extern char **OBNC_argv;
-extern OBNC_TrapHandler OBNC_handleTrap;
+extern OBNC_THREAD_LOCAL OBNC_TrapHandler OBNC_handleTrap; /*trap handler of the calling thread*/
+
+#if ! OBNC_CONFIG_TARGET_EMB
+	/*If not NULL, OBNC_ExitTrap jumps to this point instead of exiting; used to end a single task of a thread pool on a trap*/
+	extern OBNC_THREAD_LOCAL jmp_buf *OBNC_trapRecovery;
+#endif
 
 void OBNC_Init(int argc, char *argv[]);
 
+void OBNC_Trap(OBNC_INTEGER exception, const char file[], OBNC_INTEGER fileLen, OBNC_INTEGER line);
+
 void OBNC_ExitTrap(void);
 
+OBNC_INTEGER OBNC_TrapCount(OBNC_INTEGER exception);
+
 void *OBNC_Allocate(size_t size, int kind);
 
 void OBNC_Exit(int status);
 
+#if ! OBNC_CONFIG_TARGET_EMB
+
+/*Standard input is read through a ring buffer shared by modules In and Input0 so that input stays in order when both are used*/
+
+#define OBNC_INPUT_BUFFER_SIZE 65536 /*must be a power of two*/
+
+extern unsigned char OBNC_inputBuffer[OBNC_INPUT_BUFFER_SIZE];
+extern unsigned int OBNC_inputFront, OBNC_inputCount;
+
+/*returns the next character of standard input, or EOF at the end of input; waits for input if the buffer is empty*/
+#define OBNC_GET_INPUT() \
+	((OBNC_inputCount > 0)? \
+		(OBNC_inputCount--, (int) OBNC_inputBuffer[OBNC_inputFront++ & (OBNC_INPUT_BUFFER_SIZE - 1)]) \
+		: OBNC_ReadInput())
+
+int OBNC_ReadInput(void);
+
+void OBNC_UngetInput(int ch);
+
+#ifndef _WIN32
+	/*waits at most timeout milliseconds (forever if timeout is negative) until input is available, moves the available input into the buffer and returns the number of buffered characters*/
+	int OBNC_PollInput(int timeout);
+#endif
+
+#endif
+
 /*Functions used instead of the corresponding macros when a parameter contains a function call, which must not be evaluated more than once*/
 
 int OBNC_Cmp(const char s[], OBNC_INTEGER sLen, const char t[], OBNC_INTEGER tLen);
@@ -206,6 +206,12 @@ static void TestCMP(void)
 	strcpy(t, "fo");
 	t[3] = 'y';
 	assert(OBNC_CMP(s, LEN(s), t, LEN(t)) == 0);
+
+	strcpy(s, "a");
+	strcpy(t, "\x80");
+	assert(OBNC_CMP(s, LEN(s), t, LEN(t)) < 0);
+	assert(OBNC_CMP(t, LEN(t), s, LEN(s)) > 0);
+	assert(OBNC_CMP(s, LEN(s), "", LEN("")) > 0);
 }
 
 
@@ -7,6 +7,7 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #include ".obnc/Out.h"
 #include <obnc/OBNC.h>
 #include <stdio.h>
+#include <string.h>
 
 void Out__Open_(void)
 {
@@ -22,13 +23,10 @@ void Out__Char_(char ch)
 
 void Out__String_(const char s[], OBNC_INTEGER sLen)
 {
-	OBNC_INTEGER i;
+	const char *end;
 
-	i = 0;
-	while ((i < sLen) && (s[i] != '\0')) {
-		putchar(s[i]);
-		i++;
-	}
+	end = memchr(s, '\0', (size_t) sLen);
+	fwrite(s, 1, (end != NULL)? (size_t) (end - s): (size_t) sLen, stdout);
 }
 
 
@@ -56,7 +54,13 @@ void Out__Ln_(void)
 }
 
 
+void Out__Flush_(void)
+{
+	fflush(stdout);
+}
+
+
 void Out__Init(void)
 {
-	/*do nothing*/
+	/*the output buffer is set up by OBNC_Init*/
 }
@@ -36,7 +36,8 @@ abc
   0.000000E+00
 1.000000E+00
 3.700000E+01
-3.700000E-01"
+3.700000E-01
+                -5"
 
 expectedOutput1="a
 abc
@@ -55,7 +56,8 @@ abc
  0.000000E+000
 1.000000E+000
 3.700000E+001
-3.700000E-001"
+3.700000E-001
+                -5"
 
 expectedOutput2="a
 abc
@@ -74,7 +76,8 @@ abc
  0.000000E+000
 1.000000E+000
 3.700000E+001
-3.700000E-001"
+3.700000E-001
+                -5"
 
 IFS='
 '
@@ -0,0 +1,185 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
+
+#if defined __linux__ || defined __APPLE__ || defined __FreeBSD__ || defined __NetBSD__ || defined __OpenBSD__
+	#ifndef _GNU_SOURCE
+		#define _GNU_SOURCE /*memmem*/
+	#endif
+	#define HAVE_MEMMEM 1
+#endif
+
+#include ".obnc/Strings.h"
+#include <obnc/OBNC.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN(a, b) (((a) < (b))? (a): (b))
+
+/*returns the length of s up to the first null character; a missing terminator is an index out of range, as with s[LEN(s)] in Oberon*/
+static OBNC_INTEGER Length(const char s[], OBNC_INTEGER sLen)
+{
+	const char *end;
+
+	end = memchr(s, '\0', (size_t) sLen);
+	if (end == NULL) {
+		OBNC_Trap(OBNC_ARRAY_INDEX_EXCEPTION, OBNC_CFILE, sizeof OBNC_CFILE, __LINE__);
+	}
+	return (OBNC_INTEGER) (end - s);
+}
+
+
+OBNC_INTEGER Strings__Length_(const char s[], OBNC_INTEGER sLen)
+{
+	return Length(s, sLen);
+}
+
+
+void Strings__Insert_(const char source[], OBNC_INTEGER sourceLen, OBNC_INTEGER pos, char dest[], OBNC_INTEGER destLen)
+{
+	OBNC_INTEGER sourceLength, destLength, newLength;
+
+	destLength = Length(dest, destLen);
+	OBNC_C_ASSERT(pos >= 0);
+	OBNC_C_ASSERT(pos <= destLength);
+
+	sourceLength = Length(source, sourceLen);
+	newLength = MIN(destLength + sourceLength, destLen - 1);
+
+	/*make room for source in dest*/
+	if (newLength > pos + sourceLength) {
+		memmove(dest + pos + sourceLength, dest + pos, (size_t) (newLength - pos - sourceLength));
+	}
+	dest[newLength] = '\0';
+
+	/*copy source to dest*/
+	memmove(dest + pos, source, (size_t) MIN(sourceLength, newLength - pos));
+}
+
+
+void Strings__Append_(const char extra[], OBNC_INTEGER extraLen, char dest[], OBNC_INTEGER destLen)
+{
+	OBNC_INTEGER destLength, newLength;
+
+	destLength = Length(dest, destLen);
+	newLength = MIN(destLength + Length(extra, extraLen), destLen - 1);
+	memmove(dest + destLength, extra, (size_t) (newLength - destLength));
+	dest[newLength] = '\0';
+}
+
+
+void Strings__Delete_(char s[], OBNC_INTEGER sLen, OBNC_INTEGER pos, OBNC_INTEGER n)
+{
+	OBNC_INTEGER length, n1;
+
+	length = Length(s, sLen);
+	OBNC_C_ASSERT(pos >= 0);
+	OBNC_C_ASSERT(pos <= length);
+	OBNC_C_ASSERT(n >= 0);
+
+	n1 = MIN(n, length - pos); /*actual number of characters to delete*/
+	memmove(s + pos, s + pos + n1, (size_t) (length - n1 - pos + 1));
+}
+
+
+void Strings__Replace_(const char source[], OBNC_INTEGER sourceLen, OBNC_INTEGER pos, char dest[], OBNC_INTEGER destLen)
+{
+	OBNC_INTEGER destLength, n;
+
+	destLength = Length(dest, destLen);
+	OBNC_C_ASSERT(pos >= 0);
+	OBNC_C_ASSERT(pos <= destLength);
+
+	n = MIN(Length(source, sourceLen), destLen - 1 - pos); /*actual number of characters to replace*/
+	memmove(dest + pos, source, (size_t) n);
+	if (pos + n > destLength) {
+		dest[pos + n] = '\0';
+	}
+}
+
+
+void Strings__Extract_(const char source[], OBNC_INTEGER sourceLen, OBNC_INTEGER pos, OBNC_INTEGER n, char dest[], OBNC_INTEGER destLen)
+{
+	OBNC_INTEGER sourceLength, n1;
+
+	sourceLength = Length(source, sourceLen);
+	OBNC_C_ASSERT(pos >= 0);
+	OBNC_C_ASSERT(pos <= sourceLength);
+	OBNC_C_ASSERT(n >= 0);
+
+	n1 = MIN(n, MIN(sourceLength - pos, destLen - 1)); /*actual number of characters to extract*/
+	memmove(dest, source + pos, (size_t) n1);
+	dest[n1] = '\0';
+}
+
+
+/*returns a pointer to the first occurrence of the non-empty pattern pat (of length m) in the n characters at s, or NULL if there is none*/
+static const char *Search(const char s[], size_t n, const char pat[], size_t m)
+{
+#ifdef HAVE_MEMMEM
+	return memmem(s, n, pat, m);
+#else
+	const char *p, *last, *result;
+
+	/*find candidates with memchr and verify them with memcmp*/
+	result = NULL;
+	if (m <= n) {
+		p = s;
+		last = s + (n - m);
+		while ((p != NULL) && (p <= last) && (result == NULL)) {
+			p = memchr(p, pat[0], (size_t) (last - p) + 1);
+			if (p != NULL) {
+				if (memcmp(p + 1, pat + 1, m - 1) == 0) {
+					result = p;
+				} else {
+					p++;
+				}
+			}
+		}
+	}
+	return result;
+#endif
+}
+
+
+OBNC_INTEGER Strings__Pos_(const char pattern[], OBNC_INTEGER patternLen, const char s[], OBNC_INTEGER sLen, OBNC_INTEGER pos)
+{
+	OBNC_INTEGER patternLength, length, result;
+	const char *found;
+
+	OBNC_C_ASSERT(pos >= 0);
+	OBNC_C_ASSERT(pos < sLen);
+
+	patternLength = Length(pattern, patternLen);
+	length = Length(s, sLen);
+	result = -1;
+	if (patternLength == 0) {
+		result = pos;
+	} else if (pos + patternLength <= length) {
+		found = Search(s + pos, (size_t) (length - pos), pattern, (size_t) patternLength);
+		if (found != NULL) {
+			result = (OBNC_INTEGER) (found - s);
+		}
+	}
+	return result;
+}
+
+
+void Strings__Cap_(char s[], OBNC_INTEGER sLen)
+{
+	OBNC_INTEGER i, length;
+
+	length = Length(s, sLen);
+	for (i = 0; i < length; i++) {
+		if ((s[i] >= 'a') && (s[i] <= 'z')) {
+			s[i] = (char) (s[i] - 'a' + 'A');
+		}
+	}
+}
+
+
+void Strings__Init(void)
+{
+}
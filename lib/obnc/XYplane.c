@@ -8,15 +8,28 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #include ".obnc/Input.h"
 #include <obnc/OBNC.h>
 #include <SDL/SDL.h> /*SDL 1.2*/
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define LEN(arr) ((int) (sizeof (arr) / sizeof (arr)[0]))
 
-#define WITHIN_BOUNDS(x, y) (((unsigned OBNC_INTEGER) (x) < (unsigned OBNC_INTEGER) plane->w) && ((unsigned OBNC_INTEGER) (y) < (unsigned OBNC_INTEGER) plane->h))
+#define WITHIN_BOUNDS(x, y) (((unsigned OBNC_INTEGER) (x) < (unsigned OBNC_INTEGER) planeW) && ((unsigned OBNC_INTEGER) (y) < (unsigned OBNC_INTEGER) planeH))
 
-#define PIXEL_PTR(x, y) (((Uint32 *) plane->pixels) + (plane->h - 1- (y)) * plane->w + (x))
+#define PIXEL_PTR(x, y) (pixels + (planeH - 1 - (y)) * planeW + (x))
+
+#define OUTPUT_VAR "OBNC_XYPLANE_OUTPUT"
+#define DEFAULT_WIDTH 640
+#define DEFAULT_HEIGHT 480
+#define MAX_STORED_BLOCK 65535 /*maximum length of an uncompressed deflate block*/
 
 static SDL_Surface *plane;
+static Uint32 *offscreenPixels;
+
+/*current pixel rows, from top to bottom, either of the SDL surface or of the offscreen buffer*/
+static Uint32 *pixels;
+static int planeW, planeH;
 
 OBNC_INTEGER XYplane__X_ = 0;
 OBNC_INTEGER XYplane__Y_ = 0;
@@ -27,6 +40,10 @@ static OBNC_INTEGER customHeight;
 
 static Uint32 color = 0xffffff;
 
+static const char *outputPattern; /*non-NULL in offscreen mode*/
+static int frameCount;
+static int dirty; /*drawn since the last frame was written*/
+
 static void CalculatePlaneSize(int useFullscreen, int *width, int *height)
 {
 	const SDL_VideoInfo *info;
@@ -72,6 +89,16 @@ static const char *Basename(const char path[])
 }
 
 
+static void SetPlane(Uint32 *newPixels, int width, int height)
+{
+	pixels = newPixels;
+	planeW = width;
+	planeH = height;
+	XYplane__W_ = width;
+	XYplane__H_ = height;
+}
+
+
 static void Open(int useFullscreen)
 {
 	int error, width, height;
@@ -79,6 +106,8 @@ static void Open(int useFullscreen)
 
 	if (plane != NULL) {
 		SDL_Quit();
+		plane = NULL;
+		pixels = NULL;
 	}
 	error = SDL_Init(SDL_INIT_VIDEO);
 	if (! error) {
@@ -96,13 +125,13 @@ static void Open(int useFullscreen)
 		}
 		plane = SDL_SetVideoMode(width, height, 32, flags);
 		if (plane != NULL) {
-			XYplane__W_ = plane->w;
-			XYplane__H_ = plane->h;
+			SetPlane(plane->pixels, plane->w, plane->h);
 			if (SDL_MUSTLOCK(plane)) {
 				error = SDL_LockSurface(plane);
 				if (error) {
 					fprintf(stderr, "XYplane.Open failed: %s\n", SDL_GetError());
 				}
+				pixels = plane->pixels;
 			}
 		} else {
 			fprintf(stderr, "XYplane.Open failed: %s\n", SDL_GetError());
@@ -113,15 +142,269 @@ static void Open(int useFullscreen)
 }
 
 
+/*offscreen rendering*/
+
+static void PutBigEndian(unsigned char *p, unsigned long n)
+{
+	p[0] = (unsigned char) (n >> 24);
+	p[1] = (unsigned char) (n >> 16);
+	p[2] = (unsigned char) (n >> 8);
+	p[3] = (unsigned char) n;
+}
+
+
+static unsigned long Crc32(unsigned long crc, const unsigned char data[], size_t len)
+{
+	static unsigned long table[256];
+	static int tableReady;
+	unsigned long c;
+	size_t i;
+	int n, k;
+
+	if (! tableReady) {
+		for (n = 0; n < 256; n++) {
+			c = (unsigned long) n;
+			for (k = 0; k < 8; k++) {
+				c = (c & 1)? 0xedb88320UL ^ (c >> 1): c >> 1;
+			}
+			table[n] = c;
+		}
+		tableReady = 1;
+	}
+	crc = crc ^ 0xffffffffUL;
+	for (i = 0; i < len; i++) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return crc ^ 0xffffffffUL;
+}
+
+
+static void WritePngChunk(const char type[], const unsigned char data[], size_t len, FILE *file)
+{
+	unsigned char header[8], trailer[4];
+	unsigned long crc;
+
+	PutBigEndian(header, (unsigned long) len);
+	memcpy(header + 4, type, 4);
+	crc = Crc32(0, header + 4, 4);
+	crc = Crc32(crc, data, len);
+	PutBigEndian(trailer, crc);
+	fwrite(header, 1, sizeof header, file);
+	fwrite(data, 1, len, file);
+	fwrite(trailer, 1, sizeof trailer, file);
+}
+
+
+static int WritePng(FILE *file)
+{
+	static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	unsigned char header[13], *raw, *z, *p;
+	size_t rowLen, rawLen, zLen, i, blockLen;
+	unsigned long a, b;
+	Uint32 c;
+	int x, y, done;
+
+	/*the image data is a zlib stream of uncompressed deflate blocks, which keeps the writer free of dependencies*/
+	rowLen = 1 + 3 * (size_t) planeW;
+	rawLen = (size_t) planeH * rowLen;
+	zLen = 2 + rawLen + 5 * (rawLen / MAX_STORED_BLOCK + 1) + 4;
+	raw = malloc(rawLen);
+	z = malloc(zLen);
+	done = (raw != NULL) && (z != NULL);
+	if (done) {
+		p = raw;
+		for (y = 0; y < planeH; y++) {
+			*p++ = 0; /*filter type none*/
+			for (x = 0; x < planeW; x++) {
+				c = pixels[y * planeW + x];
+				*p++ = (unsigned char) (c >> 16);
+				*p++ = (unsigned char) (c >> 8);
+				*p++ = (unsigned char) c;
+			}
+		}
+		p = z;
+		*p++ = 0x78;
+		*p++ = 0x01;
+		i = 0;
+		do {
+			blockLen = (rawLen - i > MAX_STORED_BLOCK)? MAX_STORED_BLOCK: rawLen - i;
+			*p++ = (i + blockLen == rawLen)? 1: 0;
+			*p++ = (unsigned char) blockLen;
+			*p++ = (unsigned char) (blockLen >> 8);
+			*p++ = (unsigned char) ~blockLen;
+			*p++ = (unsigned char) (~blockLen >> 8);
+			memcpy(p, raw + i, blockLen);
+			p += blockLen;
+			i += blockLen;
+		} while (i < rawLen);
+		a = 1;
+		b = 0;
+		for (i = 0; i < rawLen; i++) {
+			a = (a + raw[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+		PutBigEndian(p, (b << 16) | a);
+		p += 4;
+
+		PutBigEndian(header, (unsigned long) planeW);
+		PutBigEndian(header + 4, (unsigned long) planeH);
+		header[8] = 8; /*bit depth*/
+		header[9] = 2; /*truecolor*/
+		header[10] = 0;
+		header[11] = 0;
+		header[12] = 0;
+		fwrite(signature, 1, sizeof signature, file);
+		WritePngChunk("IHDR", header, sizeof header, file);
+		WritePngChunk("IDAT", z, (size_t) (p - z), file);
+		WritePngChunk("IEND", NULL, 0, file);
+	} else {
+		errno = ENOMEM;
+	}
+	free(raw);
+	free(z);
+	return done;
+}
+
+
+static void WritePpm(FILE *file)
+{
+	unsigned char rgb[3];
+	Uint32 c;
+	int i;
+
+	fprintf(file, "P6\n%d %d\n255\n", planeW, planeH);
+	for (i = 0; i < planeW * planeH; i++) {
+		c = pixels[i];
+		rgb[0] = (unsigned char) (c >> 16);
+		rgb[1] = (unsigned char) (c >> 8);
+		rgb[2] = (unsigned char) c;
+		fwrite(rgb, 1, sizeof rgb, file);
+	}
+}
+
+
+static void GetFrameFileName(char name[], size_t nameLen)
+{
+	const char *p;
+	int width;
+	size_t i;
+
+	/*substitute the frame number for the first occurrence of %d or %0Nd*/
+	i = 0;
+	p = outputPattern;
+	while ((*p != '\0') && (i < nameLen - 1)) {
+		if ((p[0] == '%') && ((p[1] == 'd') || ((p[1] == '0') && (p[2] >= '1') && (p[2] <= '9') && (p[3] == 'd')))) {
+			width = (p[1] == 'd')? 0: p[2] - '0';
+			i += (size_t) snprintf(name + i, nameLen - i, "%0*d", width, frameCount);
+			p += (p[1] == 'd')? 2: 4;
+			if (i >= nameLen) {
+				i = nameLen - 1;
+			}
+		} else {
+			name[i] = *p;
+			i++;
+			p++;
+		}
+	}
+	name[i] = '\0';
+}
+
+
+static void WriteFrame(void)
+{
+	char name[FILENAME_MAX];
+	const char *ext;
+	FILE *file;
+	int done;
+
+	GetFrameFileName(name, sizeof name);
+	file = fopen(name, "wb");
+	if (file != NULL) {
+		ext = strrchr(name, '.');
+		if ((ext != NULL) && ((strcmp(ext, ".png") == 0) || (strcmp(ext, ".PNG") == 0))) {
+			done = WritePng(file);
+		} else {
+			WritePpm(file);
+			done = 1;
+		}
+		done = (fclose(file) == 0) && done;
+	} else {
+		done = 0;
+	}
+	if (! done) {
+		fprintf(stderr, "XYplane: writing %s failed: %s\n", name, strerror(errno));
+	}
+	frameCount++;
+	dirty = 0;
+}
+
+
+static void WriteLastFrame(void)
+{
+	if (dirty) {
+		WriteFrame();
+	}
+}
+
+
+static void OpenOffscreen(void)
+{
+	int width, height;
+
+	if ((customWidth > 0) && (customHeight > 0)) {
+		width = customWidth;
+		height = customHeight;
+	} else {
+		width = DEFAULT_WIDTH;
+		height = DEFAULT_HEIGHT;
+	}
+	if (offscreenPixels == NULL) {
+		atexit(WriteLastFrame);
+	}
+	free(offscreenPixels);
+	offscreenPixels = calloc((size_t) width * (size_t) height, sizeof offscreenPixels[0]);
+	if (offscreenPixels != NULL) {
+		SetPlane(offscreenPixels, width, height);
+		dirty = 1;
+	} else {
+		SetPlane(NULL, 0, 0);
+		fprintf(stderr, "XYplane.Open failed: out of memory\n");
+	}
+}
+
+
 void XYplane__Open_(void)
 {
-	Open(0);
+	if (outputPattern != NULL) {
+		OpenOffscreen();
+	} else {
+		Open(0);
+	}
+}
+
+
+static void Fill(Uint32 *p, int n, Uint32 c)
+{
+	int i;
+
+	if (c == 0) {
+		memset(p, 0, (size_t) n * sizeof p[0]);
+	} else {
+		for (i = 0; i < n; i++) { /*vectorized by the C compiler*/
+			p[i] = c;
+		}
+	}
 }
 
 
 void XYplane__Clear_(void)
 {
-	if (plane != NULL) {
+	if (outputPattern != NULL) {
+		if (pixels != NULL) {
+			Fill(pixels, planeW * planeH, 0);
+			dirty = 1;
+		}
+	} else if (plane != NULL) {
 		if (SDL_MUSTLOCK(plane)) {
 			SDL_LockSurface(plane);
 			SDL_FillRect(plane, NULL, 0);
@@ -135,15 +418,114 @@ void XYplane__Clear_(void)
 
 void XYplane__Dot_(OBNC_INTEGER x, OBNC_INTEGER y, OBNC_INTEGER mode)
 {
-	if ((plane != NULL) && WITHIN_BOUNDS(x, y)) {
+	if ((pixels != NULL) && WITHIN_BOUNDS(x, y)) {
 		*PIXEL_PTR(x, y) = color * mode;
+		dirty = 1;
 	}
 }
 
 
 int XYplane__IsDot_(OBNC_INTEGER x, OBNC_INTEGER y)
 {
-	return (plane != NULL) && WITHIN_BOUNDS(x, y) && (*PIXEL_PTR(x, y) != 0);
+	return (pixels != NULL) && WITHIN_BOUNDS(x, y) && (*PIXEL_PTR(x, y) != 0);
+}
+
+
+void XYplane__Line_(OBNC_INTEGER x0, OBNC_INTEGER y0, OBNC_INTEGER x1, OBNC_INTEGER y1, OBNC_INTEGER mode)
+{
+	OBNC_INTEGER dx, dy, sx, sy, err, e2;
+	Uint32 c;
+
+	if (pixels != NULL) {
+		if (y0 == y1) {
+			XYplane__FillRect_((x0 < x1)? x0: x1, y0, ((x0 < x1)? x1 - x0: x0 - x1) + 1, 1, mode);
+		} else if (x0 == x1) {
+			XYplane__FillRect_(x0, (y0 < y1)? y0: y1, 1, ((y0 < y1)? y1 - y0: y0 - y1) + 1, mode);
+		} else {
+			/*Bresenham's algorithm*/
+			c = color * mode;
+			dx = (x1 > x0)? x1 - x0: x0 - x1;
+			dy = (y1 > y0)? y0 - y1: y1 - y0;
+			sx = (x0 < x1)? 1: -1;
+			sy = (y0 < y1)? 1: -1;
+			err = dx + dy;
+			for (;;) {
+				if (WITHIN_BOUNDS(x0, y0)) {
+					*PIXEL_PTR(x0, y0) = c;
+				}
+				if ((x0 == x1) && (y0 == y1)) {
+					break;
+				}
+				e2 = 2 * err;
+				if (e2 >= dy) {
+					err += dy;
+					x0 += sx;
+				}
+				if (e2 <= dx) {
+					err += dx;
+					y0 += sy;
+				}
+			}
+			dirty = 1;
+		}
+	}
+}
+
+
+void XYplane__FillRect_(OBNC_INTEGER x, OBNC_INTEGER y, OBNC_INTEGER w, OBNC_INTEGER h, OBNC_INTEGER mode)
+{
+	OBNC_INTEGER x1, y1, row;
+	Uint32 c;
+
+	if (pixels != NULL) {
+		x1 = (w < planeW - x)? x + w: planeW;
+		y1 = (h < planeH - y)? y + h: planeH;
+		if (x < 0) {
+			x = 0;
+		}
+		if (y < 0) {
+			y = 0;
+		}
+		if ((x < x1) && (y < y1)) {
+			c = color * mode;
+			for (row = y; row < y1; row++) {
+				Fill(PIXEL_PTR(x, row), (int) (x1 - x), c);
+			}
+			dirty = 1;
+		}
+	}
+}
+
+
+void XYplane__Blit_(OBNC_INTEGER x, OBNC_INTEGER y, const OBNC_INTEGER row[], OBNC_INTEGER rowLen, OBNC_INTEGER n)
+{
+	OBNC_INTEGER i, x1;
+	Uint32 *p;
+
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= rowLen);
+
+	if ((pixels != NULL) && (y >= 0) && (y < planeH)) {
+		x1 = (n < planeW - x)? x + n: planeW;
+		i = 0;
+		if (x < 0) {
+			i = -x;
+			x = 0;
+		}
+		if (x < x1) {
+			p = PIXEL_PTR(x, y);
+			if (sizeof row[0] == sizeof p[0]) {
+				memcpy(p, row + i, (size_t) (x1 - x) * sizeof p[0]);
+			} else {
+				for (; x < x1; x++) {
+					*p = (Uint32) row[i];
+					p++;
+					i++;
+				}
+			}
+			dirty = 1;
+		}
+	}
 }
 
 
@@ -154,7 +536,11 @@ char XYplane__Key_(void)
 	char result = 0;
 	int fullscreen;
 
-	if (plane != NULL) {
+	if (outputPattern != NULL) {
+		if ((pixels != NULL) && dirty) {
+			WriteFrame();
+		}
+	} else if (plane != NULL) {
 		if (SDL_MUSTLOCK(plane)) {
 			SDL_LockSurface(plane);
 			SDL_Flip(plane);
@@ -162,6 +548,7 @@ char XYplane__Key_(void)
 		} else {
 			SDL_Flip(plane);
 		}
+		pixels = plane->pixels; /*may change when the buffers are flipped*/
 		if (Input__Available_() > 0) {
 			Input__Read_(&result);
 			fullscreen = (plane->flags & SDL_FULLSCREEN) != 0;
@@ -199,11 +586,14 @@ void XYplane__UseColor_(OBNC_INTEGER c)
 
 OBNC_INTEGER XYplane__Color_(OBNC_INTEGER x, OBNC_INTEGER y)
 {
-	return ((plane != NULL) && WITHIN_BOUNDS(x, y))? *PIXEL_PTR(x, y): 0;
+	return ((pixels != NULL) && WITHIN_BOUNDS(x, y))? *PIXEL_PTR(x, y): 0;
 }
 
 
 void XYplane__Init(void)
 {
-	/*do nothing*/
+	outputPattern = getenv(OUTPUT_VAR);
+	if ((outputPattern != NULL) && (outputPattern[0] == '\0')) {
+		outputPattern = NULL;
+	}
 }
@@ -0,0 +1,27 @@
+#!/bin/sh
+
+# Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+#
+# This file is part of OBNC.
+#
+# OBNC is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# OBNC is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with OBNC.  If not, see <http://www.gnu.org/licenses/>.
+set -e
+
+#render offscreen so that the test runs without a display
+for image in XYplaneTest.ppm XYplaneTest.png; do
+	rm -f "$image"
+	env OBNC_XYPLANE_OUTPUT="$image" ./XYplaneTest
+	test -s "$image"
+	rm "$image"
+done
@@ -0,0 +1,216 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
+
+#include ".obnc/extAtomics.h"
+#include <obnc/OBNC.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*Oberon variables are accessed as C11 atomic objects of the same type. GCC and Clang give lock-free atomic types the size and alignment of the plain type, which makes this valid in practice.*/
+#define ATOMIC_INTEGER(x) ((_Atomic OBNC_INTEGER *) (x))
+#define ATOMIC_REF(p) ((_Atomic extAtomics__Ref_ *) (p))
+
+#define CACHE_LINE 64
+#define MAX_CAPACITY (SIZE_MAX / 2 / sizeof (Cell)) /*the number of cells is less than twice the capacity*/
+
+/*The queue is the bounded MPMC queue by Dmitry Vyukov. Each cell has a sequence number which tells whether the cell is ready for the producer or the consumer with a given position, so producers and consumers only contend for the head and tail counters.*/
+
+typedef struct {
+	atomic_size_t seq;
+	extAtomics__Ref_ data;
+} Cell;
+
+typedef struct Queue *Queue;
+
+struct Queue {
+	struct extAtomics__Queue_ base;
+	Cell *cells;
+	size_t mask;
+	/*the counters are kept on separate cache lines; the heap does not guarantee cache line alignment, so padding is used instead of _Alignas*/
+	char padding1[CACHE_LINE];
+	atomic_size_t tail; /*next position to put*/
+	char padding2[CACHE_LINE];
+	atomic_size_t head; /*next position to get*/
+	char padding3[CACHE_LINE];
+};
+
+struct HeapQueue {
+	const OBNC_Td *td;
+	struct Queue fields;
+};
+
+const int extAtomics__RefDesc_id;
+const int *const extAtomics__RefDesc_ids[1] = {&extAtomics__RefDesc_id};
+const OBNC_Td extAtomics__RefDesc_td = {extAtomics__RefDesc_ids, 1};
+
+const int extAtomics__Queue_id;
+const int *const extAtomics__Queue_ids[1] = {&extAtomics__Queue_id};
+const OBNC_Td extAtomics__Queue_td = {extAtomics__Queue_ids, 1};
+
+OBNC_INTEGER extAtomics__Load_(OBNC_INTEGER *x)
+{
+	return atomic_load(ATOMIC_INTEGER(x));
+}
+
+
+void extAtomics__Store_(OBNC_INTEGER *x, OBNC_INTEGER value)
+{
+	atomic_store(ATOMIC_INTEGER(x), value);
+}
+
+
+OBNC_INTEGER extAtomics__Exchange_(OBNC_INTEGER *x, OBNC_INTEGER value)
+{
+	return atomic_exchange(ATOMIC_INTEGER(x), value);
+}
+
+
+int extAtomics__CompareExchange_(OBNC_INTEGER *x, OBNC_INTEGER *expected, OBNC_INTEGER new)
+{
+	return atomic_compare_exchange_strong(ATOMIC_INTEGER(x), expected, new);
+}
+
+
+OBNC_INTEGER extAtomics__FetchAdd_(OBNC_INTEGER *x, OBNC_INTEGER n)
+{
+	return atomic_fetch_add(ATOMIC_INTEGER(x), n);
+}
+
+
+extAtomics__Ref_ extAtomics__LoadRef_(extAtomics__Ref_ *p)
+{
+	return atomic_load(ATOMIC_REF(p));
+}
+
+
+void extAtomics__StoreRef_(extAtomics__Ref_ *p, extAtomics__Ref_ value)
+{
+	atomic_store(ATOMIC_REF(p), value);
+}
+
+
+extAtomics__Ref_ extAtomics__ExchangeRef_(extAtomics__Ref_ *p, extAtomics__Ref_ value)
+{
+	return atomic_exchange(ATOMIC_REF(p), value);
+}
+
+
+int extAtomics__CompareExchangeRef_(extAtomics__Ref_ *p, extAtomics__Ref_ *expected, extAtomics__Ref_ new)
+{
+	return atomic_compare_exchange_strong(ATOMIC_REF(p), expected, new);
+}
+
+
+void extAtomics__Fence_(void)
+{
+	atomic_thread_fence(memory_order_seq_cst);
+}
+
+
+void extAtomics__AcquireFence_(void)
+{
+	atomic_thread_fence(memory_order_acquire);
+}
+
+
+void extAtomics__ReleaseFence_(void)
+{
+	atomic_thread_fence(memory_order_release);
+}
+
+
+void extAtomics__NewQueue_(extAtomics__Queue_ *q, OBNC_INTEGER capacity)
+{
+	Queue q1;
+	size_t len, i;
+
+	OBNC_C_ASSERT(capacity > 0);
+	OBNC_C_ASSERT((unsigned OBNC_INTEGER) capacity <= MAX_CAPACITY);
+
+	len = 2; /*a single cell cannot tell a full queue from an empty one*/
+	while (len < (size_t) capacity) {
+		len *= 2;
+	}
+	OBNC_NEW(q1, &extAtomics__Queue_td, struct HeapQueue, OBNC_REGULAR_ALLOC);
+	OBNC_C_ASSERT(q1 != NULL);
+	q1->cells = OBNC_Allocate(len * sizeof q1->cells[0], OBNC_REGULAR_ALLOC);
+	OBNC_C_ASSERT(q1->cells != NULL);
+	for (i = 0; i < len; i++) {
+		atomic_init(&q1->cells[i].seq, i);
+		q1->cells[i].data = NULL;
+	}
+	q1->mask = len - 1;
+	atomic_init(&q1->tail, 0);
+	atomic_init(&q1->head, 0);
+	*q = (extAtomics__Queue_) q1;
+}
+
+
+void extAtomics__Put_(extAtomics__Queue_ q, extAtomics__Ref_ x, int *done)
+{
+	Queue q1 = (Queue) q;
+	Cell *cell;
+	size_t pos, seq;
+
+	OBNC_C_ASSERT(q1 != NULL);
+
+	*done = 0;
+	pos = atomic_load_explicit(&q1->tail, memory_order_relaxed);
+	for (;;) {
+		cell = &q1->cells[pos & q1->mask];
+		seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		if (seq == pos) {
+			/*cell is free, claim it*/
+			if (atomic_compare_exchange_weak_explicit(&q1->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				cell->data = x;
+				atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+				*done = 1;
+				break;
+			}
+		} else if ((ptrdiff_t) (seq - pos) < 0) {
+			break; /*full*/
+		} else {
+			pos = atomic_load_explicit(&q1->tail, memory_order_relaxed);
+		}
+	}
+}
+
+
+void extAtomics__Get_(extAtomics__Queue_ q, extAtomics__Ref_ *x, int *done)
+{
+	Queue q1 = (Queue) q;
+	Cell *cell;
+	size_t pos, seq;
+
+	OBNC_C_ASSERT(q1 != NULL);
+
+	*done = 0;
+	pos = atomic_load_explicit(&q1->head, memory_order_relaxed);
+	for (;;) {
+		cell = &q1->cells[pos & q1->mask];
+		seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		if (seq == pos + 1) {
+			/*cell is filled, claim it*/
+			if (atomic_compare_exchange_weak_explicit(&q1->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				*x = cell->data;
+				cell->data = NULL; /*let the collector reclaim the element*/
+				atomic_store_explicit(&cell->seq, pos + q1->mask + 1, memory_order_release);
+				*done = 1;
+				break;
+			}
+		} else if ((ptrdiff_t) (seq - (pos + 1)) < 0) {
+			break; /*empty*/
+		} else {
+			pos = atomic_load_explicit(&q1->head, memory_order_relaxed);
+		}
+	}
+}
+
+
+void extAtomics__Init(void)
+{
+}
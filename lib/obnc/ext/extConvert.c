@@ -7,83 +7,678 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #include ".obnc/extConvert.h"
 #include <obnc/OBNC.h>
 #include <float.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-static int Length(int i)
+#define LEN(arr) ((int) (sizeof (arr) / sizeof (arr)[0]))
+
+#if OBNC_CONFIG_C_REAL_TYPE == OBNC_CONFIG_DOUBLE
+	#define GRISU 1 /*shortest digits with the Grisu2 algorithm*/
+#endif
+
+#define REAL_BUFFER_SIZE (LDBL_DIG + 32)
+
+static const char digitPairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+/*writes the decimal representation of i backwards, ending just before end, and returns a pointer to its first character*/
+static char *FormatInt(OBNC_INTEGER i, char *end)
 {
+	unsigned OBNC_INTEGER u;
+	char *p;
+
+	u = (i < 0)? 0u - (unsigned OBNC_INTEGER) i: (unsigned OBNC_INTEGER) i;
+	p = end;
+	while (u >= 100) {
+		p -= 2;
+		memcpy(p, digitPairs + 2 * (u % 100), 2);
+		u /= 100;
+	}
+	if (u >= 10) {
+		p -= 2;
+		memcpy(p, digitPairs + 2 * u, 2);
+	} else {
+		p--;
+		*p = (char) ('0' + u);
+	}
+	if (i < 0) {
+		p--;
+		*p = '-';
+	}
+	return p;
+}
+
+
+void extConvert__IntToString_(OBNC_INTEGER i, char s[], OBNC_INTEGER sLen, int *done)
+{
+	char buffer[3 * sizeof (OBNC_INTEGER) + 2];
+	char *start;
 	int n;
 
-	if (i == 0) {
-		n = 1;
+	start = FormatInt(i, buffer + LEN(buffer));
+	n = (int) (buffer + LEN(buffer) - start);
+	if (n < sLen) {
+		memcpy(s, start, (size_t) n);
+		s[n] = '\0';
+		*done = 1;
 	} else {
-		n = 0;
-		if (i < 0) {
+		*done = 0;
+	}
+}
+
+
+#ifdef GRISU
+
+/*Grisu2 after Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers" (2010); the digits always convert back to the same number and are the shortest such digits in all but rare cases*/
+
+typedef struct {
+	uint64_t f;
+	int e;
+} DiyFp;
+
+/*normalized approximations of 10^k for k = -348, -340, ..., 340*/
+static const DiyFp cachedPowers[] = {
+	{0xFA8FD5A0081C0288ULL, -1220},
+	{0xBAAEE17FA23EBF76ULL, -1193},
+	{0x8B16FB203055AC76ULL, -1166},
+	{0xCF42894A5DCE35EAULL, -1140},
+	{0x9A6BB0AA55653B2DULL, -1113},
+	{0xE61ACF033D1A45DFULL, -1087},
+	{0xAB70FE17C79AC6CAULL, -1060},
+	{0xFF77B1FCBEBCDC4FULL, -1034},
+	{0xBE5691EF416BD60CULL, -1007},
+	{0x8DD01FAD907FFC3CULL, -980},
+	{0xD3515C2831559A83ULL, -954},
+	{0x9D71AC8FADA6C9B5ULL, -927},
+	{0xEA9C227723EE8BCBULL, -901},
+	{0xAECC49914078536DULL, -874},
+	{0x823C12795DB6CE57ULL, -847},
+	{0xC21094364DFB5637ULL, -821},
+	{0x9096EA6F3848984FULL, -794},
+	{0xD77485CB25823AC7ULL, -768},
+	{0xA086CFCD97BF97F4ULL, -741},
+	{0xEF340A98172AACE5ULL, -715},
+	{0xB23867FB2A35B28EULL, -688},
+	{0x84C8D4DFD2C63F3BULL, -661},
+	{0xC5DD44271AD3CDBAULL, -635},
+	{0x936B9FCEBB25C996ULL, -608},
+	{0xDBAC6C247D62A584ULL, -582},
+	{0xA3AB66580D5FDAF6ULL, -555},
+	{0xF3E2F893DEC3F126ULL, -529},
+	{0xB5B5ADA8AAFF80B8ULL, -502},
+	{0x87625F056C7C4A8BULL, -475},
+	{0xC9BCFF6034C13053ULL, -449},
+	{0x964E858C91BA2655ULL, -422},
+	{0xDFF9772470297EBDULL, -396},
+	{0xA6DFBD9FB8E5B88FULL, -369},
+	{0xF8A95FCF88747D94ULL, -343},
+	{0xB94470938FA89BCFULL, -316},
+	{0x8A08F0F8BF0F156BULL, -289},
+	{0xCDB02555653131B6ULL, -263},
+	{0x993FE2C6D07B7FACULL, -236},
+	{0xE45C10C42A2B3B06ULL, -210},
+	{0xAA242499697392D3ULL, -183},
+	{0xFD87B5F28300CA0EULL, -157},
+	{0xBCE5086492111AEBULL, -130},
+	{0x8CBCCC096F5088CCULL, -103},
+	{0xD1B71758E219652CULL, -77},
+	{0x9C40000000000000ULL, -50},
+	{0xE8D4A51000000000ULL, -24},
+	{0xAD78EBC5AC620000ULL, 3},
+	{0x813F3978F8940984ULL, 30},
+	{0xC097CE7BC90715B3ULL, 56},
+	{0x8F7E32CE7BEA5C70ULL, 83},
+	{0xD5D238A4ABE98068ULL, 109},
+	{0x9F4F2726179A2245ULL, 136},
+	{0xED63A231D4C4FB27ULL, 162},
+	{0xB0DE65388CC8ADA8ULL, 189},
+	{0x83C7088E1AAB65DBULL, 216},
+	{0xC45D1DF942711D9AULL, 242},
+	{0x924D692CA61BE758ULL, 269},
+	{0xDA01EE641A708DEAULL, 295},
+	{0xA26DA3999AEF774AULL, 322},
+	{0xF209787BB47D6B85ULL, 348},
+	{0xB454E4A179DD1877ULL, 375},
+	{0x865B86925B9BC5C2ULL, 402},
+	{0xC83553C5C8965D3DULL, 428},
+	{0x952AB45CFA97A0B3ULL, 455},
+	{0xDE469FBD99A05FE3ULL, 481},
+	{0xA59BC234DB398C25ULL, 508},
+	{0xF6C69A72A3989F5CULL, 534},
+	{0xB7DCBF5354E9BECEULL, 561},
+	{0x88FCF317F22241E2ULL, 588},
+	{0xCC20CE9BD35C78A5ULL, 614},
+	{0x98165AF37B2153DFULL, 641},
+	{0xE2A0B5DC971F303AULL, 667},
+	{0xA8D9D1535CE3B396ULL, 694},
+	{0xFB9B7CD9A4A7443CULL, 720},
+	{0xBB764C4CA7A44410ULL, 747},
+	{0x8BAB8EEFB6409C1AULL, 774},
+	{0xD01FEF10A657842CULL, 800},
+	{0x9B10A4E5E9913129ULL, 827},
+	{0xE7109BFBA19C0C9DULL, 853},
+	{0xAC2820D9623BF429ULL, 880},
+	{0x80444B5E7AA7CF85ULL, 907},
+	{0xBF21E44003ACDD2DULL, 933},
+	{0x8E679C2F5E44FF8FULL, 960},
+	{0xD433179D9C8CB841ULL, 986},
+	{0x9E19DB92B4E31BA9ULL, 1013},
+	{0xEB96BF6EBADF77D9ULL, 1039},
+	{0xAF87023B9BF0EE6BULL, 1066}
+};
+
+static const uint64_t pow10Table[20] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+	10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+	1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+	10000000000000000000ULL
+};
+
+static DiyFp Multiply(DiyFp x, DiyFp y)
+{
+	const uint64_t mask32 = 0xFFFFFFFFu;
+	uint64_t a, b, c, d, ac, bc, ad, bd, tmp;
+	DiyFp result;
+
+	a = x.f >> 32;
+	b = x.f & mask32;
+	c = y.f >> 32;
+	d = y.f & mask32;
+	ac = a * c;
+	bc = b * c;
+	ad = a * d;
+	bd = b * d;
+	tmp = (bd >> 32) + (ad & mask32) + (bc & mask32) + (1u << 31);
+	result.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+	result.e = x.e + y.e + 64;
+	return result;
+}
+
+
+static DiyFp Normalized(DiyFp x)
+{
+	while ((x.f & (1ULL << 63)) == 0) {
+		x.f <<= 1;
+		x.e--;
+	}
+	return x;
+}
+
+
+static void GrisuRound(char digits[], int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw)
+{
+	while ((rest < wpw) && (delta - rest >= tenKappa)
+			&& ((rest + tenKappa < wpw) || (wpw - rest > rest + tenKappa - wpw))) {
+		digits[len - 1]--;
+		rest += tenKappa;
+	}
+}
+
+
+/*Grisu2 sometimes produces 16 or 17 digits such as 7413968999999999 where 7413969 converts back to the same number; Shorten(x, digits, len, k) tries the shorter candidate and keeps it if it converts back to x*/
+static void Shorten(double x, char digits[], int *len, int *k)
+{
+	char candidate[48];
+	int i, j, n;
+
+	i = *len - 2;
+	while ((i > 0) && (digits[i] == digits[*len - 2])) {
+		i--;
+	}
+	i++; /*digits[i .. len - 2] is a run of equal digits*/
+	if ((*len - 1 - i >= 3) && ((digits[i] == '0') || (digits[i] == '9'))) {
+		memcpy(candidate, digits, (size_t) i);
+		n = i;
+		if (digits[i] == '9') {
+			j = n - 1;
+			while ((j >= 0) && (candidate[j] == '9')) {
+				candidate[j] = '0';
+				j--;
+			}
+			if (j >= 0) {
+				candidate[j]++;
+			} else {
+				memmove(candidate + 1, candidate, (size_t) n);
+				candidate[0] = '1';
+				n++;
+			}
+		}
+		while ((n > 1) && (candidate[n - 1] == '0')) {
+			n--;
+		}
+		sprintf(candidate + n, "E%d", *k + *len - n);
+		if (strtod(candidate, NULL) == x) {
+			memcpy(digits, candidate, (size_t) n);
+			*k += *len - n;
+			*len = n;
+		}
+	}
+}
+
+
+/*sets digits[0 .. *len - 1] and *k so that the decimal number digits * 10^k converts back to the positive finite x*/
+static void ShortestDigits(double x, char digits[], int *len, int *k)
+{
+	const uint64_t hiddenBit = 1ULL << 52;
+	uint64_t bits, delta, one, p2, tmp, wpw;
+	uint32_t p1, d;
+	DiyFp v, w, mPlus, mMinus, cached;
+	double dk;
+	int index, kappa, n, cachedIndex;
+
+	memcpy(&bits, &x, sizeof bits);
+	if ((bits >> 52) != 0) {
+		v.f = (bits & (hiddenBit - 1)) + hiddenBit;
+		v.e = (int) (bits >> 52) - 1075;
+	} else {
+		v.f = bits & (hiddenBit - 1);
+		v.e = -1074;
+	}
+
+	/*boundaries of the rounding interval of x*/
+	mPlus.f = (v.f << 1) + 1;
+	mPlus.e = v.e - 1;
+	mPlus = Normalized(mPlus);
+	if (v.f == hiddenBit) {
+		mMinus.f = (v.f << 2) - 1;
+		mMinus.e = v.e - 2;
+	} else {
+		mMinus.f = (v.f << 1) - 1;
+		mMinus.e = v.e - 1;
+	}
+	mMinus.f <<= mMinus.e - mPlus.e;
+	mMinus.e = mPlus.e;
+
+	/*scale by a cached power of ten so that the exponent is in [-60, -32]*/
+	dk = (-61 - mPlus.e) * 0.30102999566398114 + 347;
+	cachedIndex = (int) dk;
+	if (dk - cachedIndex > 0.0) {
+		cachedIndex++;
+	}
+	cachedIndex = (cachedIndex >> 3) + 1;
+	*k = -(-348 + cachedIndex * 8);
+	cached = cachedPowers[cachedIndex];
+	w = Multiply(Normalized(v), cached);
+	mPlus = Multiply(mPlus, cached);
+	mMinus = Multiply(mMinus, cached);
+	mMinus.f++;
+	mPlus.f--;
+
+	/*generate digits of mPlus until they are within delta of w*/
+	delta = mPlus.f - mMinus.f;
+	wpw = mPlus.f - w.f;
+	one = 1ULL << -mPlus.e;
+	p1 = (uint32_t) (mPlus.f >> -mPlus.e);
+	p2 = mPlus.f & (one - 1);
+	kappa = 1;
+	while ((kappa < 10) && (p1 >= pow10Table[kappa])) {
+		kappa++;
+	}
+	n = 0;
+	while (kappa > 0) {
+		d = (uint32_t) (p1 / pow10Table[kappa - 1]);
+		p1 = (uint32_t) (p1 % pow10Table[kappa - 1]);
+		if ((d != 0) || (n > 0)) {
+			digits[n] = (char) ('0' + d);
 			n++;
 		}
-		while (i != 0) {
-			i = i / 10;
+		kappa--;
+		tmp = ((uint64_t) p1 << -mPlus.e) + p2;
+		if (tmp <= delta) {
+			*k += kappa;
+			GrisuRound(digits, n, delta, tmp, pow10Table[kappa] << -mPlus.e, wpw);
+			*len = n;
+			if (n >= 16) {
+				Shorten(x, digits, len, k);
+			}
+			return;
+		}
+	}
+	for (;;) {
+		p2 *= 10;
+		delta *= 10;
+		d = (uint32_t) (p2 >> -mPlus.e);
+		if ((d != 0) || (n > 0)) {
+			digits[n] = (char) ('0' + d);
 			n++;
 		}
+		p2 &= one - 1;
+		kappa--;
+		if (p2 < delta) {
+			*k += kappa;
+			index = -kappa;
+			GrisuRound(digits, n, delta, p2, one, (index < LEN(pow10Table))? wpw * pow10Table[index]: 0);
+			*len = n;
+			if (n >= 16) {
+				Shorten(x, digits, len, k);
+			}
+			return;
+		}
 	}
-	return n;
 }
 
+#else
 
-void extConvert__IntToString_(OBNC_INTEGER i, char s[], OBNC_INTEGER sLen, int *done)
+/*sets digits[0 .. *len - 1] and *k so that the decimal number digits * 10^k converts back to the positive finite x; uses the shortest precision of %E that does*/
+static void ShortestDigits(OBNC_REAL x, char digits[], int *len, int *k)
 {
-	int strLen, n;
+	char buffer[REAL_BUFFER_SIZE];
+	OBNC_REAL y;
+	int precision, n, i, exp;
 
-	strLen = Length(i);
-	if (strLen < sLen) {
-		n = sprintf(s, "%" OBNC_INT_MOD "d", i);
-		*done = n == strLen;
+	precision = 0;
+	do {
+		sprintf(buffer, "%.*" OBNC_REAL_MOD_W "E", precision, x);
+		sscanf(buffer, "%" OBNC_REAL_MOD_R "f", &y);
+		precision++;
+	} while ((y != x) && (precision < LDBL_DIG + 3));
+	n = 0;
+	for (i = 0; buffer[i] != 'E'; i++) {
+		if (buffer[i] != '.') {
+			digits[n] = buffer[i];
+			n++;
+		}
+	}
+	exp = atoi(buffer + i + 1);
+	while ((n > 1) && (digits[n - 1] == '0')) {
+		n--;
+	}
+	*len = n;
+	*k = exp - n + 1;
+}
+
+#endif
+
+/*Writes the non-finite x as %E does (INF, -INF or NAN) and returns the length*/
+static int FormatNonFinite(OBNC_REAL x, char s[])
+{
+	if (x != x) {
+		strcpy(s, "NAN");
+	} else if (x > 0) {
+		strcpy(s, "INF");
 	} else {
-		*done = 0;
+		strcpy(s, "-INF");
 	}
+	return (int) strlen(s);
 }
 
 
 void extConvert__RealToString_(OBNC_REAL x, char s[], OBNC_INTEGER sLen, int *done)
 {
-	char buffer[LDBL_DIG + 9]; /*LDBL_DIG + strlen("-") + strlen(".") + strlen("e+9999") + 1*/
-	int n;
+	char buffer[REAL_BUFFER_SIZE], digits[REAL_BUFFER_SIZE];
+	int n, len, k, exp, i;
+	char *p;
 
-	*done = 0;
-	n = sprintf(buffer, "%" OBNC_REAL_MOD_W "E", x);
+	n = -1;
+	if (x - x == 0) {
+		/*%E with the default precision is the shortest representation padded with zeros if that has at most 7 digits*/
+		if (x == 0) {
+			digits[0] = '0';
+			len = 1;
+			k = 0;
+		} else {
+			ShortestDigits((x < 0)? -x: x, digits, &len, &k);
+		}
+		if (len <= 7) {
+			p = buffer;
+			if ((x < 0) || ((x == 0) && (1 / x < 0))) {
+				*p++ = '-';
+			}
+			*p++ = digits[0];
+			*p++ = '.';
+			for (i = 1; i < 7; i++) {
+				*p++ = (i < len)? digits[i]: '0';
+			}
+			*p++ = 'E';
+			exp = (x == 0)? 0: k + len - 1;
+			*p++ = (exp < 0)? '-': '+';
+			exp = abs(exp);
+			if (exp >= 100) {
+				*p++ = (char) ('0' + exp / 100);
+				exp %= 100;
+			}
+			memcpy(p, digitPairs + 2 * exp, 2);
+			p += 2;
+			*p = '\0';
+			n = (int) (p - buffer);
+		}
+	}
+	if (n < 0) {
+		n = sprintf(buffer, "%" OBNC_REAL_MOD_W "E", x);
+	}
 	if (n < sLen) {
-		strcpy(s, buffer);
+		memcpy(s, buffer, (size_t) n + 1);
 		*done = 1;
+	} else {
+		*done = 0;
+	}
+}
+
+
+void extConvert__RealToShortString_(OBNC_REAL x, char s[], OBNC_INTEGER sLen, int *done)
+{
+	char buffer[REAL_BUFFER_SIZE + 24], digits[REAL_BUFFER_SIZE];
+	int n, len, k, exp, i;
+	char *p, *start;
+
+	p = buffer;
+	if ((x < 0) || ((x == 0) && (1 / x < 0))) {
+		*p++ = '-';
+		x = -x;
+	}
+	if (x - x != 0) {
+		n = FormatNonFinite(x, buffer);
+	} else {
+		if (x == 0) {
+			digits[0] = '0';
+			len = 1;
+			k = 0;
+		} else {
+			ShortestDigits(x, digits, &len, &k);
+		}
+		exp = len + k - 1; /*decimal exponent of the first digit*/
+		if ((exp >= 21) || (exp < -7)) {
+			*p++ = digits[0];
+			*p++ = '.';
+			if (len > 1) {
+				memcpy(p, digits + 1, (size_t) len - 1);
+				p += len - 1;
+			} else {
+				*p++ = '0';
+			}
+			*p++ = 'E';
+			start = FormatInt(exp, p + 8);
+			memmove(p, start, (size_t) (p + 8 - start));
+			p += p + 8 - start;
+		} else if (k >= 0) {
+			memcpy(p, digits, (size_t) len);
+			p += len;
+			for (i = 0; i < k; i++) {
+				*p++ = '0';
+			}
+			*p++ = '.';
+			*p++ = '0';
+		} else if (exp >= 0) {
+			memcpy(p, digits, (size_t) exp + 1);
+			p += exp + 1;
+			*p++ = '.';
+			memcpy(p, digits + exp + 1, (size_t) (len - exp - 1));
+			p += len - exp - 1;
+		} else {
+			*p++ = '0';
+			*p++ = '.';
+			for (i = -1; i > exp; i--) {
+				*p++ = '0';
+			}
+			memcpy(p, digits, (size_t) len);
+			p += len;
+		}
+		*p = '\0';
+		n = (int) (p - buffer);
+	}
+	if (n < sLen) {
+		memcpy(s, buffer, (size_t) n + 1);
+		*done = 1;
+	} else {
+		*done = 0;
+	}
+}
+
+
+static int IsSpace(char ch)
+{
+	return (ch == ' ') || ((ch >= '\t') && (ch <= '\r'));
+}
+
+
+static int HexDigitValue(char ch)
+{
+	int result = -1;
+
+	if ((ch >= '0') && (ch <= '9')) {
+		result = ch - '0';
+	} else if ((ch >= 'A') && (ch <= 'F')) {
+		result = ch - 'A' + 10;
+	} else if ((ch >= 'a') && (ch <= 'f')) {
+		result = ch - 'a' + 10;
 	}
+	return result;
 }
 
 
 void extConvert__StringToInt_(const char s[], OBNC_INTEGER sLen, OBNC_INTEGER *i, int *done)
 {
-	unsigned OBNC_INTEGER j;
-	int n;
-	char ch;
+	unsigned OBNC_INTEGER u, max;
+	const char *p, *q;
+	int negative, d, overflow;
 
 	OBNC_C_ASSERT(OBNC_Terminated(s, sLen));
 
-	/*TODO: check for overflow by using strtol*/
-	n = sscanf(s, " %" OBNC_INT_MOD "x%c", &j, &ch);
-    if ((n == 2) && (ch == 'H')) {
-    		*i = j;
-		*done = 1;
+	p = s;
+	while (IsSpace(*p)) {
+		p++;
+	}
+	negative = *p == '-';
+	if ((*p == '-') || (*p == '+')) {
+		p++;
+	}
+	q = p;
+	while (HexDigitValue(*q) >= 0) {
+		q++;
+	}
+	u = 0;
+	overflow = 0;
+	if ((q > p) && (*q == 'H')) {
+		/*hexadecimal, any bit pattern that fits in an INTEGER*/
+		for (; p < q; p++) {
+			overflow |= u > (unsigned OBNC_INTEGER) OBNC_UINT_MAX >> 4;
+			u = (u << 4) | (unsigned OBNC_INTEGER) HexDigitValue(*p);
+		}
+		*done = ! overflow;
 	} else {
-		n = sscanf(s, " %" OBNC_INT_MOD "d", i);
-		*done = n == 1;
+		/*decimal, leading digits only*/
+		max = negative? 0u - (unsigned OBNC_INTEGER) OBNC_INT_MIN: (unsigned OBNC_INTEGER) OBNC_INT_MAX;
+		q = p;
+		for (; (*p >= '0') && (*p <= '9'); p++) {
+			d = *p - '0';
+			overflow |= u > (max - (unsigned OBNC_INTEGER) d) / 10;
+			u = u * 10 + (unsigned OBNC_INTEGER) d;
+		}
+		*done = (p > q) && ! overflow;
+	}
+	if (*done) {
+		*i = (OBNC_INTEGER) (negative? 0u - u: u);
 	}
 }
 
 
+#ifdef GRISU
+
+/*converts a decimal number with at most 15 significant digits and a power of ten at most 22 exactly, otherwise returns 0*/
+static int ParseRealExactly(const char s[], OBNC_REAL *x)
+{
+	static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const char *p;
+	uint64_t m;
+	int negative, digitCount, significantCount, exp, scale, scaleSign, result;
+
+	p = s;
+	while (IsSpace(*p)) {
+		p++;
+	}
+	negative = *p == '-';
+	if ((*p == '-') || (*p == '+')) {
+		p++;
+	}
+	m = 0;
+	digitCount = 0;
+	significantCount = 0;
+	exp = 0;
+	for (; (*p >= '0') && (*p <= '9'); p++) {
+		m = m * 10 + (uint64_t) (*p - '0');
+		significantCount += m != 0;
+		digitCount++;
+	}
+	if (*p == '.') {
+		p++;
+		for (; (*p >= '0') && (*p <= '9'); p++) {
+			m = m * 10 + (uint64_t) (*p - '0');
+			significantCount += m != 0;
+			digitCount++;
+			exp--;
+		}
+	}
+	if (((*p == 'E') || (*p == 'e')) && (digitCount > 0)) {
+		p++;
+		scaleSign = 1;
+		if ((*p == '-') || (*p == '+')) {
+			scaleSign = (*p == '-')? -1: 1;
+			p++;
+		}
+		if ((*p >= '0') && (*p <= '9')) {
+			scale = 0;
+			for (; (*p >= '0') && (*p <= '9') && (scale < 1000); p++) {
+				scale = scale * 10 + (*p - '0');
+			}
+			exp += scaleSign * scale;
+		}
+	}
+	result = (digitCount > 0) && (significantCount <= 15) && (exp >= -22) && (exp <= 22)
+		&& (HexDigitValue(*p) < 0) && (*p != 'x') && (*p != 'X') && (*p != '.');
+	if (result) {
+		*x = (exp >= 0)? (double) m * powers[exp]: (double) m / powers[-exp];
+		if (negative) {
+			*x = -*x;
+		}
+	}
+	return result;
+}
+
+#endif
+
 void extConvert__StringToReal_(const char s[], OBNC_INTEGER sLen, OBNC_REAL *x, int *done)
 {
 	int n;
 
 	OBNC_C_ASSERT(OBNC_Terminated(s, sLen));
 
+#ifdef GRISU
+	if (ParseRealExactly(s, x)) {
+		*done = 1;
+		return;
+	}
+#endif
 	n = sscanf(s, " %" OBNC_REAL_MOD_R "f", x);
 	*done = n == 1;
 }
@@ -1,7 +1,16 @@
+#if defined __linux__ && ! defined _GNU_SOURCE
+	#define _GNU_SOURCE /*F_SETPIPE_SZ*/
+#endif
+
 #include ".obnc/extPipes.h"
 #include <obnc/OBNC.h>
+#ifndef _WIN32
+	#include <fcntl.h>
+#endif
 #include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define READ_MODE 0
 #define WRITE_MODE 1
@@ -12,6 +21,7 @@ struct Stream {
 	struct extPipes__Stream_ base;
 	FILE *file;
 	int readWriteMode;
+	char *buffer; /*non-NULL if set with SetBufferSize; allocated with malloc since only the FILE refers to it*/
 };
 
 struct HeapStream {
@@ -38,6 +48,7 @@ static void Open(const char command[], OBNC_INTEGER commandLen, int readWriteMod
 			stream1->base.eof_ = 0;
 			stream1->file = file;
 			stream1->readWriteMode = readWriteMode;
+			stream1->buffer = NULL;
 			*stream = (extPipes__Stream_) stream1;
 		} else {
 			fprintf(stderr, "Pipes.Open failed: out of memory\n");
@@ -92,6 +103,107 @@ void extPipes__Write_(char ch, extPipes__Stream_ stream)
 }
 
 
+void extPipes__ReadBytes_(extPipes__Stream_ stream, unsigned char buf[], OBNC_INTEGER bufLen, OBNC_INTEGER n, OBNC_INTEGER *count)
+{
+	FILE *file;
+	size_t nRead;
+
+	OBNC_C_ASSERT(stream != NULL);
+	OBNC_C_ASSERT(((Stream) stream)->readWriteMode == READ_MODE);
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= bufLen);
+
+	file = ((Stream) stream)->file;
+	nRead = fread(buf, sizeof buf[0], (size_t) n, file);
+	*count = (OBNC_INTEGER) nRead;
+	if ((OBNC_INTEGER) nRead < n) {
+		stream->eof_ = 1;
+	}
+}
+
+
+void extPipes__ReadLine_(extPipes__Stream_ stream, char line[], OBNC_INTEGER lineLen)
+{
+	FILE *file;
+	char *end;
+	int ch, consumed;
+
+	OBNC_C_ASSERT(stream != NULL);
+	OBNC_C_ASSERT(((Stream) stream)->readWriteMode == READ_MODE);
+	OBNC_C_ASSERT(lineLen > 0);
+
+	file = ((Stream) stream)->file;
+	line[0] = '\0';
+	end = NULL;
+	consumed = 0;
+	if ((lineLen > 1) && (fgets(line, (int) lineLen, file) != NULL)) {
+		consumed = 1;
+		end = strchr(line, '\n');
+		if (end != NULL) {
+			*end = '\0';
+		}
+	}
+	if (end == NULL) { /*skip the rest of the line*/
+		ch = fgetc(file);
+		if (ch != EOF) {
+			consumed = 1;
+		}
+		while ((ch != EOF) && (ch != '\n')) {
+			ch = fgetc(file);
+		}
+	}
+	if (! consumed) {
+		stream->eof_ = 1;
+	}
+}
+
+
+void extPipes__WriteBytes_(unsigned char buf[], OBNC_INTEGER bufLen, OBNC_INTEGER n, extPipes__Stream_ stream)
+{
+	size_t nWritten;
+
+	OBNC_C_ASSERT(stream != NULL);
+	OBNC_C_ASSERT(((Stream) stream)->readWriteMode == WRITE_MODE);
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= bufLen);
+
+	nWritten = fwrite(buf, sizeof buf[0], (size_t) n, ((Stream) stream)->file);
+	if ((OBNC_INTEGER) nWritten < n) {
+		stream->eof_ = 1;
+	}
+}
+
+
+void extPipes__SetBufferSize_(extPipes__Stream_ stream, OBNC_INTEGER size)
+{
+	Stream s;
+	char *buffer;
+	int error;
+
+	OBNC_C_ASSERT(stream != NULL);
+	OBNC_C_ASSERT(((Stream) stream)->file != NULL);
+	OBNC_C_ASSERT(size > 0);
+
+	s = (Stream) stream;
+	buffer = malloc((size_t) size);
+	if (buffer != NULL) {
+		error = setvbuf(s->file, buffer, _IOFBF, (size_t) size);
+		if (! error) {
+			free(s->buffer);
+			s->buffer = buffer;
+		} else {
+			fprintf(stderr, "Pipes.SetBufferSize failed: %s\n", strerror(errno));
+			free(buffer);
+		}
+	} else {
+		fprintf(stderr, "Pipes.SetBufferSize failed: out of memory\n");
+	}
+#ifdef F_SETPIPE_SZ
+	fcntl(fileno(s->file), F_SETPIPE_SZ, (int) size); /*a capacity above the system limit is not an error*/
+#endif
+}
+
+
 void extPipes__Close_(extPipes__Stream_ stream, OBNC_INTEGER *exitCode)
 {
 	OBNC_C_ASSERT(stream != NULL);
@@ -99,6 +211,8 @@ void extPipes__Close_(extPipes__Stream_ stream, OBNC_INTEGER *exitCode)
 
 	*exitCode = pclose(((Stream) stream)->file);
 	((Stream) stream)->file = NULL;
+	free(((Stream) stream)->buffer);
+	((Stream) stream)->buffer = NULL;
 }
 
 
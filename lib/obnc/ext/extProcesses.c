@@ -0,0 +1,661 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
+
+#include ".obnc/extProcesses.h"
+#include <obnc/OBNC.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+	#include <fcntl.h>
+	#include <poll.h>
+	#include <signal.h>
+	#include <spawn.h>
+	#include <sys/types.h>
+	#include <sys/wait.h>
+	#include <time.h>
+	#include <unistd.h>
+#endif
+
+#define READ_MODE 0
+#define WRITE_MODE 1
+
+#define BUFFER_SIZE 4096
+#define MAX_WAIT_DELAY 50 /*milliseconds*/
+
+typedef struct Stream *Stream;
+
+struct Stream {
+	struct extProcesses__Stream_ base;
+	int fd; /*-1 if closed*/
+	int readWriteMode;
+	int pos, len; /*unread part of buffer*/
+	unsigned char buffer[BUFFER_SIZE];
+};
+
+struct HeapStream {
+	const OBNC_Td *td;
+	struct Stream fields;
+};
+
+typedef struct Process *Process;
+
+struct Process {
+	struct extProcesses__Process_ base;
+	long pid; /*0 if waited for*/
+};
+
+struct HeapProcess {
+	const OBNC_Td *td;
+	struct Process fields;
+};
+
+const int extProcesses__Stream_id;
+const int *const extProcesses__Stream_ids[1] = {&extProcesses__Stream_id};
+const OBNC_Td extProcesses__Stream_td = {extProcesses__Stream_ids, 1};
+
+const int extProcesses__Process_id;
+const int *const extProcesses__Process_ids[1] = {&extProcesses__Process_id};
+const OBNC_Td extProcesses__Process_td = {extProcesses__Process_ids, 1};
+
+#ifndef _WIN32
+
+extern char **environ;
+
+static void CloseFd(int *fd)
+{
+	if (*fd >= 0) {
+		close(*fd);
+		*fd = -1;
+	}
+}
+
+
+static int NewPipe(int fds[2])
+{
+	int done, i, flags, error;
+
+	done = pipe(fds) == 0;
+	/*prevent the parent's ends from leaking into other child processes, or their input would never reach its end*/
+	for (i = 0; done && (i < 2); i++) {
+		flags = fcntl(fds[i], F_GETFD);
+		done = (flags >= 0) && (fcntl(fds[i], F_SETFD, flags | FD_CLOEXEC) >= 0);
+	}
+	if (! done) {
+		error = errno;
+		CloseFd(&fds[0]);
+		CloseFd(&fds[1]);
+		errno = error;
+	}
+	return done;
+}
+
+
+static void IgnoreBrokenPipes(void)
+{
+	static int done;
+	struct sigaction action;
+
+	/*writing to a terminated process should set eof rather than terminate the calling program*/
+	if (! done) {
+		if ((sigaction(SIGPIPE, NULL, &action) == 0) && (action.sa_handler == SIG_DFL)) {
+			signal(SIGPIPE, SIG_IGN);
+		}
+		done = 1;
+	}
+}
+
+
+static int Spawn(char *argv[], const int inPipe[2], const int outPipe[2], const int errPipe[2], long *pid)
+{
+	posix_spawn_file_actions_t actions;
+	posix_spawnattr_t attr;
+	sigset_t defaultSignals;
+	pid_t pid1;
+	int error;
+
+	error = posix_spawn_file_actions_init(&actions);
+	if (! error) {
+		error = posix_spawnattr_init(&attr);
+		if (! error) {
+			posix_spawn_file_actions_adddup2(&actions, inPipe[0], 0);
+			posix_spawn_file_actions_adddup2(&actions, outPipe[1], 1);
+			if (errPipe[1] >= 0) {
+				posix_spawn_file_actions_adddup2(&actions, errPipe[1], 2);
+			}
+			sigemptyset(&defaultSignals);
+			sigaddset(&defaultSignals, SIGPIPE);
+			posix_spawnattr_setsigdefault(&attr, &defaultSignals);
+			posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+			error = posix_spawnp(&pid1, argv[0], &actions, &attr, argv, environ);
+			if (! error) {
+				*pid = pid1;
+			}
+			posix_spawnattr_destroy(&attr);
+		}
+		posix_spawn_file_actions_destroy(&actions);
+	}
+	return error;
+}
+
+
+static extProcesses__Stream_ NewStream(int fd, int readWriteMode)
+{
+	Stream s;
+
+	OBNC_NEW(s, &extProcesses__Stream_td, struct HeapStream, OBNC_ATOMIC_NOINIT_ALLOC);
+	if (s != NULL) {
+		s->base.eof_ = 0;
+		s->fd = fd;
+		s->readWriteMode = readWriteMode;
+		s->pos = 0;
+		s->len = 0;
+	}
+	return (extProcesses__Stream_) s;
+}
+
+
+/*kills and reaps a child process which cannot be handed to the caller so that it does not remain a zombie*/
+static void KillChild(long pid)
+{
+	int status;
+	pid_t result;
+
+	kill((pid_t) pid, SIGKILL);
+	do {
+		result = waitpid((pid_t) pid, &status, 0);
+	} while ((result < 0) && (errno == EINTR));
+}
+
+
+void extProcesses__Start_(const char args[], OBNC_INTEGER argsLen, OBNC_INTEGER argsLen1, OBNC_INTEGER argc, int captureErr, extProcesses__Process_ *p)
+{
+	int inPipe[2] = {-1, -1}, outPipe[2] = {-1, -1}, errPipe[2] = {-1, -1};
+	int error;
+	char **argv;
+	OBNC_INTEGER i;
+	long pid;
+	Process p1;
+
+	OBNC_C_ASSERT(argc > 0);
+	OBNC_C_ASSERT(argc <= argsLen);
+
+	*p = NULL;
+	argv = malloc((size_t) (argc + 1) * sizeof argv[0]);
+	if (argv != NULL) {
+		for (i = 0; i < argc; i++) {
+			OBNC_C_ASSERT(OBNC_Terminated(args + i * argsLen1, argsLen1));
+			argv[i] = (char *) (args + i * argsLen1);
+		}
+		argv[argc] = NULL;
+		IgnoreBrokenPipes();
+		if (NewPipe(inPipe) && NewPipe(outPipe) && (! captureErr || NewPipe(errPipe))) {
+			error = Spawn(argv, inPipe, outPipe, errPipe, &pid);
+		} else {
+			error = errno;
+		}
+		free(argv);
+		CloseFd(&inPipe[0]);
+		CloseFd(&outPipe[1]);
+		CloseFd(&errPipe[1]);
+		if (! error) {
+			OBNC_NEW(p1, &extProcesses__Process_td, struct HeapProcess, OBNC_REGULAR_ALLOC);
+			if (p1 != NULL) {
+				p1->base.in_ = NewStream(inPipe[1], WRITE_MODE);
+				p1->base.out_ = NewStream(outPipe[0], READ_MODE);
+				p1->base.err_ = captureErr? NewStream(errPipe[0], READ_MODE): NULL;
+				p1->pid = pid;
+			}
+			if ((p1 != NULL) && (p1->base.in_ != NULL) && (p1->base.out_ != NULL) && (! captureErr || (p1->base.err_ != NULL))) {
+				*p = (extProcesses__Process_) p1;
+			} else {
+				fprintf(stderr, "Processes.Start failed: out of memory\n");
+				KillChild(pid);
+			}
+		} else {
+			fprintf(stderr, "Processes.Start failed: %s\n", strerror(error));
+		}
+		if (*p == NULL) {
+			CloseFd(&inPipe[1]);
+			CloseFd(&outPipe[0]);
+			CloseFd(&errPipe[0]);
+		}
+	} else {
+		fprintf(stderr, "Processes.Start failed: out of memory\n");
+	}
+}
+
+
+static OBNC_INTEGER Unbuffer(Stream s, unsigned char buf[], OBNC_INTEGER n)
+{
+	OBNC_INTEGER count;
+
+	count = s->len - s->pos;
+	if (count > n) {
+		count = n;
+	}
+	memcpy(buf, s->buffer + s->pos, (size_t) count);
+	s->pos += (int) count;
+	return count;
+}
+
+
+static OBNC_INTEGER ReadFd(Stream s, unsigned char buf[], OBNC_INTEGER n)
+{
+	ssize_t count;
+
+	do {
+		count = read(s->fd, buf, (size_t) n);
+	} while ((count < 0) && (errno == EINTR));
+	if (count <= 0) {
+		s->base.eof_ = 1;
+		count = 0;
+	}
+	return (OBNC_INTEGER) count;
+}
+
+
+static int Readable(int fd, int timeout)
+{
+	struct pollfd pfd;
+	int n;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+	do {
+		n = poll(&pfd, 1, timeout);
+	} while ((n < 0) && (errno == EINTR));
+	return n > 0;
+}
+
+
+void extProcesses__Read_(extProcesses__Stream_ s, char *ch)
+{
+	Stream s1 = (Stream) s;
+
+	OBNC_C_ASSERT(s != NULL);
+	OBNC_C_ASSERT(s1->readWriteMode == READ_MODE);
+	OBNC_C_ASSERT(s1->fd >= 0);
+
+	if (s1->pos == s1->len) {
+		s1->pos = 0;
+		s1->len = (int) ReadFd(s1, s1->buffer, BUFFER_SIZE);
+	}
+	if (s1->pos < s1->len) {
+		*ch = (char) s1->buffer[s1->pos];
+		s1->pos++;
+	}
+}
+
+
+void extProcesses__ReadBytes_(extProcesses__Stream_ s, unsigned char buf[], OBNC_INTEGER bufLen, OBNC_INTEGER n, OBNC_INTEGER *count)
+{
+	Stream s1 = (Stream) s;
+
+	OBNC_C_ASSERT(s != NULL);
+	OBNC_C_ASSERT(s1->readWriteMode == READ_MODE);
+	OBNC_C_ASSERT(s1->fd >= 0);
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= bufLen);
+
+	*count = Unbuffer(s1, buf, n);
+	while ((*count < n) && ! s->eof_) {
+		*count += ReadFd(s1, buf + *count, n - *count);
+	}
+}
+
+
+void extProcesses__ReadAvailable_(extProcesses__Stream_ s, unsigned char buf[], OBNC_INTEGER bufLen, OBNC_INTEGER n, OBNC_INTEGER *count)
+{
+	Stream s1 = (Stream) s;
+
+	OBNC_C_ASSERT(s != NULL);
+	OBNC_C_ASSERT(s1->readWriteMode == READ_MODE);
+	OBNC_C_ASSERT(s1->fd >= 0);
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= bufLen);
+
+	*count = Unbuffer(s1, buf, n);
+	if ((*count == 0) && (n > 0) && Readable(s1->fd, 0)) {
+		*count = ReadFd(s1, buf, n);
+	}
+}
+
+
+static void WriteFd(Stream s, const unsigned char buf[], OBNC_INTEGER n)
+{
+	ssize_t count;
+
+	while ((n > 0) && ! s->base.eof_) {
+		count = write(s->fd, buf, (size_t) n);
+		if (count > 0) {
+			buf += count;
+			n -= (OBNC_INTEGER) count;
+		} else if ((count < 0) && (errno != EINTR)) {
+			s->base.eof_ = 1;
+		}
+	}
+}
+
+
+void extProcesses__Write_(char ch, extProcesses__Stream_ s)
+{
+	unsigned char buf[1];
+
+	OBNC_C_ASSERT(s != NULL);
+	OBNC_C_ASSERT(((Stream) s)->readWriteMode == WRITE_MODE);
+	OBNC_C_ASSERT(((Stream) s)->fd >= 0);
+
+	buf[0] = (unsigned char) ch;
+	WriteFd((Stream) s, buf, 1);
+}
+
+
+void extProcesses__WriteBytes_(unsigned char buf[], OBNC_INTEGER bufLen, OBNC_INTEGER n, extProcesses__Stream_ s)
+{
+	OBNC_C_ASSERT(s != NULL);
+	OBNC_C_ASSERT(((Stream) s)->readWriteMode == WRITE_MODE);
+	OBNC_C_ASSERT(((Stream) s)->fd >= 0);
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= bufLen);
+
+	WriteFd((Stream) s, buf, n);
+}
+
+
+void extProcesses__CloseInput_(extProcesses__Process_ p)
+{
+	OBNC_C_ASSERT(p != NULL);
+
+	CloseFd(&((Stream) p->in_)->fd);
+}
+
+
+void extProcesses__Select_(const extProcesses__Process_ ps[], OBNC_INTEGER psLen, OBNC_INTEGER n, OBNC_INTEGER timeout, OBNC_INTEGER *i)
+{
+	struct pollfd *fds;
+	OBNC_INTEGER *owners, j, nfds;
+	Stream streams[2];
+	int k, count;
+
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= psLen);
+
+	*i = -1;
+	fds = malloc((size_t) (2 * n + 1) * sizeof fds[0]);
+	owners = malloc((size_t) (2 * n + 1) * sizeof owners[0]);
+	if ((fds != NULL) && (owners != NULL)) {
+		nfds = 0;
+		for (j = 0; (j < n) && (*i < 0); j++) {
+			if (ps[j] != NULL) {
+				streams[0] = (Stream) ps[j]->out_;
+				streams[1] = (Stream) ps[j]->err_;
+				for (k = 0; k < 2; k++) {
+					if ((streams[k] != NULL) && (streams[k]->fd >= 0)) {
+						if ((streams[k]->pos < streams[k]->len) || streams[k]->base.eof_) {
+							*i = j; /*readable without blocking*/
+						}
+						fds[nfds].fd = streams[k]->fd;
+						fds[nfds].events = POLLIN;
+						owners[nfds] = j;
+						nfds++;
+					}
+				}
+			}
+		}
+		if ((*i < 0) && (nfds > 0)) {
+			do {
+				count = poll(fds, (nfds_t) nfds, (int) timeout);
+			} while ((count < 0) && (errno == EINTR));
+			if (count > 0) {
+				j = 0;
+				while (fds[j].revents == 0) {
+					j++;
+				}
+				*i = owners[j];
+			} else if (count < 0) {
+				fprintf(stderr, "Processes.Select failed: %s\n", strerror(errno));
+			}
+		}
+	} else {
+		fprintf(stderr, "Processes.Select failed: out of memory\n");
+	}
+	free(fds);
+	free(owners);
+}
+
+
+static void CloseStreams(Process p)
+{
+	CloseFd(&((Stream) p->base.in_)->fd);
+	CloseFd(&((Stream) p->base.out_)->fd);
+	if (p->base.err_ != NULL) {
+		CloseFd(&((Stream) p->base.err_)->fd);
+	}
+}
+
+
+static OBNC_INTEGER ExitCode(pid_t result, int status)
+{
+	return ((result > 0) && WIFEXITED(status))? WEXITSTATUS(status): -1;
+}
+
+
+void extProcesses__Wait_(extProcesses__Process_ p, OBNC_INTEGER *exitCode)
+{
+	Process p1 = (Process) p;
+	pid_t result;
+	int status;
+
+	OBNC_C_ASSERT(p != NULL);
+	OBNC_C_ASSERT(p1->pid != 0);
+
+	CloseStreams(p1);
+	do {
+		result = waitpid((pid_t) p1->pid, &status, 0);
+	} while ((result < 0) && (errno == EINTR));
+	*exitCode = ExitCode(result, status);
+	p1->pid = 0;
+}
+
+
+static int childPipe[2] = {-1, -1}; /*written to when a child process terminates*/
+
+static void HandleChildSignal(int sig)
+{
+	int savedErrno;
+	ssize_t count;
+
+	(void) sig;
+	savedErrno = errno;
+	count = write(childPipe[1], "", 1);
+	(void) count;
+	errno = savedErrno;
+}
+
+
+/*returns true if terminated child processes are signaled on childPipe, which requires that the calling program does not handle SIGCHLD itself*/
+static int CatchChildSignals(void)
+{
+	static int done;
+	struct sigaction action;
+	int i, flags;
+
+	if (! done) {
+		if ((sigaction(SIGCHLD, NULL, &action) == 0) && (action.sa_handler == SIG_DFL) && NewPipe(childPipe)) {
+			for (i = 0; i < 2; i++) {
+				flags = fcntl(childPipe[i], F_GETFL);
+				if (flags >= 0) {
+					fcntl(childPipe[i], F_SETFL, flags | O_NONBLOCK);
+				}
+			}
+			action.sa_handler = HandleChildSignal;
+			sigemptyset(&action.sa_mask);
+			action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+			if (sigaction(SIGCHLD, &action, NULL) != 0) {
+				CloseFd(&childPipe[0]);
+				CloseFd(&childPipe[1]);
+			}
+		}
+		done = 1;
+	}
+	return childPipe[0] >= 0;
+}
+
+
+static void DrainChildPipe(void)
+{
+	char buf[64];
+
+	while (read(childPipe[0], buf, sizeof buf) > 0) {
+		/*discard*/
+	}
+}
+
+
+static void WaitForChildSignal(void)
+{
+	struct pollfd pfd;
+
+	pfd.fd = childPipe[0];
+	pfd.events = POLLIN;
+	while ((poll(&pfd, 1, -1) < 0) && (errno == EINTR)) {
+		/*retry*/
+	}
+}
+
+
+void extProcesses__WaitAny_(const extProcesses__Process_ ps[], OBNC_INTEGER psLen, OBNC_INTEGER n, OBNC_INTEGER *i, OBNC_INTEGER *exitCode)
+{
+	Process p;
+	OBNC_INTEGER j;
+	int signaled, remaining, status;
+	pid_t result;
+	long delay;
+	struct timespec interval;
+
+	OBNC_C_ASSERT(n >= 0);
+	OBNC_C_ASSERT(n <= psLen);
+
+	/*waitpid(-1, ...) would also reap children that are not ours, so the given processes are checked each time a child process has terminated; if the calling program handles SIGCHLD itself they are polled with an increasing delay instead*/
+	signaled = CatchChildSignals();
+	*i = -1;
+	delay = 1;
+	do {
+		if (signaled) {
+			DrainChildPipe();
+		}
+		remaining = 0;
+		for (j = 0; (j < n) && (*i < 0); j++) {
+			p = (Process) ps[j];
+			if ((p != NULL) && (p->pid != 0)) {
+				remaining = 1;
+				result = waitpid((pid_t) p->pid, &status, WNOHANG);
+				if ((result > 0) || ((result < 0) && (errno != EINTR))) {
+					CloseStreams(p);
+					*exitCode = ExitCode(result, status);
+					p->pid = 0;
+					*i = j;
+				}
+			}
+		}
+		if (remaining && (*i < 0)) {
+			if (signaled) {
+				WaitForChildSignal();
+			} else {
+				interval.tv_sec = 0;
+				interval.tv_nsec = delay * 1000000L;
+				nanosleep(&interval, NULL);
+				if (delay < MAX_WAIT_DELAY) {
+					delay *= 2;
+				}
+			}
+		}
+	} while (remaining && (*i < 0));
+}
+
+#else
+
+static void Unsupported(const char procName[])
+{
+	fprintf(stderr, "Processes.%s failed: not supported on this platform\n", procName);
+}
+
+
+void extProcesses__Start_(const char args[], OBNC_INTEGER argsLen, OBNC_INTEGER argsLen1, OBNC_INTEGER argc, int captureErr, extProcesses__Process_ *p)
+{
+	*p = NULL;
+	Unsupported("Start");
+}
+
+
+void extProcesses__Read_(extProcesses__Stream_ s, char *ch)
+{
+	OBNC_C_ASSERT(s != NULL);
+	*ch = '\0';
+}
+
+
+void extProcesses__ReadBytes_(extProcesses__Stream_ s, unsigned char buf[], OBNC_INTEGER bufLen, OBNC_INTEGER n, OBNC_INTEGER *count)
+{
+	OBNC_C_ASSERT(s != NULL);
+	*count = 0;
+}
+
+
+void extProcesses__ReadAvailable_(extProcesses__Stream_ s, unsigned char buf[], OBNC_INTEGER bufLen, OBNC_INTEGER n, OBNC_INTEGER *count)
+{
+	OBNC_C_ASSERT(s != NULL);
+	*count = 0;
+}
+
+
+void extProcesses__Write_(char ch, extProcesses__Stream_ s)
+{
+	OBNC_C_ASSERT(s != NULL);
+}
+
+
+void extProcesses__WriteBytes_(unsigned char buf[], OBNC_INTEGER bufLen, OBNC_INTEGER n, extProcesses__Stream_ s)
+{
+	OBNC_C_ASSERT(s != NULL);
+}
+
+
+void extProcesses__CloseInput_(extProcesses__Process_ p)
+{
+	OBNC_C_ASSERT(p != NULL);
+}
+
+
+void extProcesses__Select_(const extProcesses__Process_ ps[], OBNC_INTEGER psLen, OBNC_INTEGER n, OBNC_INTEGER timeout, OBNC_INTEGER *i)
+{
+	*i = -1;
+	Unsupported("Select");
+}
+
+
+void extProcesses__Wait_(extProcesses__Process_ p, OBNC_INTEGER *exitCode)
+{
+	OBNC_C_ASSERT(p != NULL);
+	*exitCode = -1;
+}
+
+
+void extProcesses__WaitAny_(const extProcesses__Process_ ps[], OBNC_INTEGER psLen, OBNC_INTEGER n, OBNC_INTEGER *i, OBNC_INTEGER *exitCode)
+{
+	*i = -1;
+	*exitCode = -1;
+}
+
+#endif
+
+
+void extProcesses__Init(void)
+{
+	/*do nothing*/
+}
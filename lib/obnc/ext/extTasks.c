@@ -0,0 +1,475 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This Source Code Form is subject to the terms of the Mozilla Public
+License, v. 2.0. If a copy of the MPL was not distributed with this
+file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
+
+#include ".obnc/extTasks.h"
+#include <obnc/OBNC.h>
+#if ! (OBNC_CONFIG_NO_GC || OBNC_CONFIG_TARGET_EMB)
+	#define GC_THREADS /*redirects pthread_create to GC_pthread_create so that the collector knows about the workers*/
+	#include <gc/gc.h>
+#endif
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h>
+#if ! (defined __STDC_VERSION__ && __STDC_VERSION__ >= 201112L) || defined __STDC_NO_ATOMICS__
+	#error "extTasks requires a C11 compiler with support for atomics"
+#endif
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+#define MAX_WORKERS 256
+#define DEQUE_LEN 4096 /*power of two*/
+#define SPINS_BEFORE_SLEEP 64
+
+const int extTasks__ArgDesc_id;
+const int *const extTasks__ArgDesc_ids[1] = {&extTasks__ArgDesc_id};
+const OBNC_Td extTasks__ArgDesc_td = {extTasks__ArgDesc_ids, 1};
+
+/*the tasks created by a task or by the main program*/
+typedef struct {
+	atomic_long pending; /*number of unfinished tasks*/
+} Frame;
+
+typedef struct {
+	extTasks__Proc_ proc; /*NULL for a part of a ParallelFor range*/
+	extTasks__Body_ body;
+	extTasks__Arg_ arg;
+	OBNC_INTEGER from, to, grain;
+	Frame *parent;
+} Task;
+
+/*Each thread in the pool owns a Chase-Lev work-stealing deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models", 2013). The owner pushes and pops at the bottom and other threads steal from the top.*/
+typedef struct {
+	_Alignas(64) atomic_long top;
+	_Alignas(64) atomic_long bottom;
+	_Atomic(Task *) *slots; /*allocated with OBNC_Allocate so that the collector sees the tasks*/
+	unsigned int seed; /*for choosing victims*/
+} Worker;
+
+static Worker workers[MAX_WORKERS];
+static int workerCount, started;
+static pthread_t mainThread;
+static Frame rootFrame; /*tasks created by the main program outside of a task*/
+static OBNC_TrapHandler mainTrapHandler; /*initial trap handler of the worker threads*/
+static atomic_int recoverTraps;
+static atomic_long failedCount;
+
+static atomic_long queued; /*number of tasks in all deques*/
+static atomic_int sleeping;
+static pthread_mutex_t sleepLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t workAvailable = PTHREAD_COND_INITIALIZER;
+static atomic_int joining; /*number of threads sleeping in Join*/
+static pthread_cond_t joinEvent = PTHREAD_COND_INITIALIZER; /*a frame has finished or a task has been queued*/
+
+static OBNC_THREAD_LOCAL Worker *self; /*NULL in threads outside of the pool*/
+static OBNC_THREAD_LOCAL Frame *currentFrame;
+
+static int Push(Worker *w, Task *t)
+{
+	long b, t0;
+	int done;
+
+	b = atomic_load_explicit(&w->bottom, memory_order_relaxed);
+	t0 = atomic_load_explicit(&w->top, memory_order_acquire);
+	done = b - t0 < DEQUE_LEN;
+	if (done) {
+		atomic_store_explicit(&w->slots[b & (DEQUE_LEN - 1)], t, memory_order_relaxed);
+		atomic_thread_fence(memory_order_release);
+		atomic_store_explicit(&w->bottom, b + 1, memory_order_relaxed);
+	}
+	return done;
+}
+
+
+static Task *Pop(Worker *w)
+{
+	long b, t0;
+	Task *result;
+
+	b = atomic_load_explicit(&w->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&w->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	t0 = atomic_load_explicit(&w->top, memory_order_relaxed);
+	result = NULL;
+	if (t0 <= b) {
+		result = atomic_load_explicit(&w->slots[b & (DEQUE_LEN - 1)], memory_order_relaxed);
+		if (t0 == b) {
+			/*last task, race against thieves*/
+			if (! atomic_compare_exchange_strong_explicit(&w->top, &t0, t0 + 1, memory_order_seq_cst, memory_order_relaxed)) {
+				result = NULL;
+			}
+			atomic_store_explicit(&w->bottom, b + 1, memory_order_relaxed);
+		}
+	} else {
+		atomic_store_explicit(&w->bottom, b + 1, memory_order_relaxed);
+	}
+	return result;
+}
+
+
+static Task *StealFrom(Worker *w)
+{
+	long b, t0;
+	Task *result;
+
+	t0 = atomic_load_explicit(&w->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	b = atomic_load_explicit(&w->bottom, memory_order_acquire);
+	result = NULL;
+	if (t0 < b) {
+		result = atomic_load_explicit(&w->slots[t0 & (DEQUE_LEN - 1)], memory_order_relaxed);
+		if (! atomic_compare_exchange_strong_explicit(&w->top, &t0, t0 + 1, memory_order_seq_cst, memory_order_relaxed)) {
+			result = NULL;
+		}
+	}
+	return result;
+}
+
+
+/*returns a task from the calling thread's deque or, if it is empty, one stolen from another thread*/
+static Task *NextTask(void)
+{
+	Task *result;
+	int start, i;
+
+	result = Pop(self);
+	if ((result == NULL) && (workerCount > 1)) {
+		self->seed = self->seed * 1103515245u + 12345u;
+		start = (int) ((self->seed >> 16) % (unsigned int) workerCount);
+		for (i = 0; (i < workerCount) && (result == NULL); i++) {
+			if (&workers[(start + i) % workerCount] != self) {
+				result = StealFrom(&workers[(start + i) % workerCount]);
+			}
+		}
+	}
+	if (result != NULL) {
+		atomic_fetch_sub(&queued, 1);
+	}
+	return result;
+}
+
+
+static void Run(Task *t);
+
+/*executes tasks until all tasks in frame f have finished*/
+static void Join(Frame *f)
+{
+	Task *t;
+	int misses;
+
+	misses = 0;
+	while (atomic_load_explicit(&f->pending, memory_order_acquire) > 0) {
+		t = NextTask();
+		if (t != NULL) {
+			Run(t);
+			misses = 0;
+		} else if (misses < SPINS_BEFORE_SLEEP) {
+			misses++;
+			sched_yield();
+		} else {
+			/*joining is announced before pending and queued are checked, and Run and SpawnTask check joining after they decrement pending or increment queued, so a wakeup cannot be lost*/
+			pthread_mutex_lock(&sleepLock);
+			atomic_fetch_add(&joining, 1);
+			if ((atomic_load(&f->pending) > 0) && (atomic_load(&queued) == 0)) {
+				pthread_cond_wait(&joinEvent, &sleepLock);
+			}
+			atomic_fetch_sub(&joining, 1);
+			pthread_mutex_unlock(&sleepLock);
+			misses = 0;
+		}
+	}
+}
+
+
+static void RunRange(extTasks__Body_ body, extTasks__Arg_ arg, OBNC_INTEGER from, OBNC_INTEGER to, OBNC_INTEGER grain);
+
+static void Call(Task *t)
+{
+	if (t->proc != NULL) {
+		t->proc(t->arg);
+	} else {
+		RunRange(t->body, t->arg, t->from, t->to, t->grain);
+	}
+}
+
+
+/*calls the procedure of t with frame as the current frame; with trap recovery, a trap returns here*/
+static void Execute(Task *t, Frame *frame)
+{
+	jmp_buf recovery, *savedRecovery;
+
+	currentFrame = frame;
+	if (atomic_load_explicit(&recoverTraps, memory_order_relaxed)) {
+		savedRecovery = OBNC_trapRecovery;
+		if (setjmp(recovery) == 0) {
+			OBNC_trapRecovery = &recovery;
+			Call(t);
+		} else {
+			currentFrame = frame;
+			atomic_fetch_add_explicit(&failedCount, 1, memory_order_relaxed);
+		}
+		OBNC_trapRecovery = savedRecovery;
+	} else {
+		Call(t);
+	}
+}
+
+
+static void Run(Task *t)
+{
+	Frame frame, *savedFrame;
+
+	atomic_init(&frame.pending, 0);
+	savedFrame = currentFrame;
+	Execute(t, &frame);
+	Join(&frame);
+	currentFrame = savedFrame;
+	if ((atomic_fetch_sub(&t->parent->pending, 1) == 1) && (atomic_load(&joining) > 0)) {
+		pthread_mutex_lock(&sleepLock);
+		pthread_cond_broadcast(&joinEvent);
+		pthread_mutex_unlock(&sleepLock);
+	}
+#if OBNC_CONFIG_NO_GC
+	free(t);
+#endif
+}
+
+
+static void *WorkerMain(void *arg)
+{
+	Task *t;
+	int misses;
+
+	self = arg;
+	OBNC_handleTrap = mainTrapHandler;
+	misses = 0;
+	for (;;) {
+		t = NextTask();
+		if (t != NULL) {
+			Run(t);
+			misses = 0;
+		} else if (misses < SPINS_BEFORE_SLEEP) {
+			misses++;
+			sched_yield();
+		} else {
+			/*sleeping is announced before queued is checked and Spawn checks sleeping after queued is incremented, so a wakeup cannot be lost*/
+			pthread_mutex_lock(&sleepLock);
+			atomic_fetch_add(&sleeping, 1);
+			if (atomic_load(&queued) == 0) {
+				pthread_cond_wait(&workAvailable, &sleepLock);
+			}
+			atomic_fetch_sub(&sleeping, 1);
+			pthread_mutex_unlock(&sleepLock);
+			misses = 0;
+		}
+	}
+	return NULL;
+}
+
+
+static int ProcessorCount(void)
+{
+	long n;
+
+#ifdef _WIN32
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	n = (long) info.dwNumberOfProcessors;
+#else
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (n < 1) {
+		n = 1;
+	} else if (n > MAX_WORKERS) {
+		n = MAX_WORKERS;
+	}
+	return (int) n;
+}
+
+
+static void Start(void)
+{
+	pthread_t thread;
+	int i, error;
+
+	OBNC_C_ASSERT(pthread_equal(pthread_self(), mainThread));
+	started = 1;
+	if (workerCount == 0) {
+		workerCount = ProcessorCount();
+	}
+	for (i = 0; i < workerCount; i++) {
+		workers[i].slots = OBNC_Allocate(DEQUE_LEN * sizeof workers[i].slots[0], OBNC_REGULAR_ALLOC);
+		OBNC_C_ASSERT(workers[i].slots != NULL);
+		workers[i].seed = (unsigned int) i + 1;
+	}
+	self = &workers[0];
+	mainTrapHandler = OBNC_handleTrap;
+	for (i = 1; i < workerCount; i++) {
+		error = pthread_create(&thread, NULL, WorkerMain, &workers[i]);
+		if (error == 0) {
+			pthread_detach(thread);
+		} else {
+			fprintf(stderr, "extTasks: creating worker thread failed: %s\n", strerror(error));
+			workerCount = i;
+		}
+	}
+}
+
+
+static void SpawnTask(Task *t)
+{
+	if (! started) {
+		Start();
+	}
+	OBNC_C_ASSERT(self != NULL);
+	t->parent = (currentFrame != NULL)? currentFrame: &rootFrame;
+	atomic_fetch_add_explicit(&t->parent->pending, 1, memory_order_relaxed);
+	if (Push(self, t)) {
+		atomic_fetch_add(&queued, 1);
+		if ((atomic_load(&sleeping) > 0) || (atomic_load(&joining) > 0)) {
+			pthread_mutex_lock(&sleepLock);
+			if (atomic_load(&sleeping) > 0) {
+				pthread_cond_signal(&workAvailable);
+			}
+			if (atomic_load(&joining) > 0) {
+				pthread_cond_broadcast(&joinEvent); /*joiners may steal the new task*/
+			}
+			pthread_mutex_unlock(&sleepLock);
+		}
+	} else {
+		Run(t); /*deque full*/
+	}
+}
+
+
+static Task *NewTask(void)
+{
+	Task *result;
+
+	result = OBNC_Allocate(sizeof *result, OBNC_REGULAR_ALLOC);
+	OBNC_C_ASSERT(result != NULL);
+	return result;
+}
+
+
+static void RunRange(extTasks__Body_ body, extTasks__Arg_ arg, OBNC_INTEGER from, OBNC_INTEGER to, OBNC_INTEGER grain)
+{
+	OBNC_INTEGER i, mid;
+	Task *t;
+
+	/*hand the upper halves to other threads*/
+	while (to - from > grain) {
+		mid = from + (to - from) / 2;
+		t = NewTask();
+		t->proc = NULL;
+		t->body = body;
+		t->arg = arg;
+		t->from = mid;
+		t->to = to;
+		t->grain = grain;
+		SpawnTask(t);
+		to = mid;
+	}
+	for (i = from; i < to; i++) {
+		body(i, arg);
+	}
+}
+
+
+void extTasks__SetWorkerCount_(OBNC_INTEGER n)
+{
+	OBNC_C_ASSERT(! started);
+	OBNC_C_ASSERT((n > 0) && (n <= MAX_WORKERS));
+	workerCount = (int) n;
+}
+
+
+OBNC_INTEGER extTasks__WorkerCount_(void)
+{
+	if (workerCount == 0) {
+		workerCount = ProcessorCount();
+	}
+	return workerCount;
+}
+
+
+void extTasks__Spawn_(extTasks__Proc_ proc, extTasks__Arg_ arg)
+{
+	Task *t;
+
+	OBNC_C_ASSERT(proc != NULL);
+	t = NewTask();
+	t->proc = proc;
+	t->arg = arg;
+	SpawnTask(t);
+}
+
+
+void extTasks__Wait_(void)
+{
+	if (started) {
+		OBNC_C_ASSERT(self != NULL);
+		Join((currentFrame != NULL)? currentFrame: &rootFrame);
+	}
+}
+
+
+void extTasks__SetTrapRecovery_(int on)
+{
+	atomic_store(&recoverTraps, on);
+}
+
+
+OBNC_INTEGER extTasks__FailedCount_(void)
+{
+	return (OBNC_INTEGER) atomic_load(&failedCount);
+}
+
+
+void extTasks__ParallelFor_(OBNC_INTEGER from, OBNC_INTEGER to, extTasks__Body_ body, extTasks__Arg_ arg, OBNC_INTEGER grain)
+{
+	Frame frame, *savedFrame;
+	Task range;
+
+	OBNC_C_ASSERT(body != NULL);
+	if (from < to) {
+		if (! started) {
+			Start();
+		}
+		OBNC_C_ASSERT(self != NULL);
+		if (grain <= 0) {
+			grain = (to - from) / (8 * workerCount);
+			if (grain < 1) {
+				grain = 1;
+			}
+		}
+		range.proc = NULL;
+		range.body = body;
+		range.arg = arg;
+		range.from = from;
+		range.to = to;
+		range.grain = grain;
+		atomic_init(&frame.pending, 0);
+		savedFrame = currentFrame;
+		Execute(&range, &frame);
+		Join(&frame);
+		currentFrame = savedFrame;
+	}
+}
+
+
+void extTasks__Init(void)
+{
+	mainThread = pthread_self();
+}
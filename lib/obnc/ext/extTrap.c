@@ -8,17 +8,28 @@ file, You can obtain one at http://mozilla.org/MPL/2.0/.*/
 #include <obnc/OBNC.h>
 
 extTrap__Handler_ extTrap__handle_;
+static OBNC_THREAD_LOCAL int mainThread; /*set in the thread that initializes the module*/
 
 void extTrap__SetHandler_(extTrap__Handler_ h)
 {
 	OBNC_C_ASSERT(h != NULL);
 
 	OBNC_handleTrap = h;
-	extTrap__handle_ = h;
+	if (mainThread) {
+		extTrap__handle_ = h;
+	}
+}
+
+
+OBNC_INTEGER extTrap__Count_(OBNC_INTEGER exception)
+{
+	OBNC_C_ASSERT((exception >= 0) && (exception <= OBNC_EXCEPTION_COUNT));
+	return OBNC_TrapCount(exception);
 }
 
 
 void extTrap__Init(void)
 {
+	mainThread = 1;
 	extTrap__handle_ = OBNC_handleTrap;
 }
@@ -17,9 +17,11 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 #include "Generate.h"
 #include "Config.h"
 #include "Files.h"
+#include "Intervals.h"
 #include "Maps.h"
 #include "Oberon.h"
 #include "Paths.h"
+#include "Stats.h"
 #include "Trees.h"
 #include "Types.h"
 #include "Util.h"
@@ -71,12 +73,18 @@ static struct ProcedureDeclNode {
 
 static int addressOperationUsed;
 
+static const char *checkFamilies[] = {"index", "pointer", "call", "guard", "assignment"}; /*indexed by GENERATE_<FAMILY>_CHECKS*/
+static const char *checkConstants[] = {"OBNC_CONFIG_NO_INDEX_CHECKS", "OBNC_CONFIG_NO_POINTER_CHECKS", "OBNC_CONFIG_NO_CALL_CHECKS", "OBNC_CONFIG_NO_GUARD_CHECKS", "OBNC_CONFIG_NO_ASSIGNMENT_CHECKS"};
+static const char *checkModes[] = {"default", "on", "off", "debug"}; /*indexed by GENERATE_CHECKS_<MODE>*/
+static int checks[LEN(checkFamilies)];
+
 void Generate_Init(void)
 {
 	if (! initialized) {
 		initialized = 1;
 		Config_Init();
 		Files_Init();
+		Intervals_Init();
 		Oberon_Init();
 		Trees_Init();
 		Util_Init();
@@ -323,6 +331,7 @@ static void GenerateChar(char ch, FILE *file)
 void Generate_ConstDeclaration(Trees_Node ident)
 {
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 
 	GenerateInternalDeclarations(CONST_SECTION);
 	if (Trees_Exported(ident)) {
@@ -333,6 +342,7 @@ void Generate_ConstDeclaration(Trees_Node ident)
 		Generate(Trees_Value(ident), hFile, 0);
 		fprintf(hFile, "\n");
 	}
+	Stats_Leave();
 }
 
 
@@ -765,6 +775,7 @@ void Generate_TypeDeclaration(Trees_Node ident)
 	int modulePrefixNeeded;
 
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 	GenerateInternalDeclarations(TYPE_SECTION);
 
 	type = Trees_Type(ident);
@@ -795,6 +806,7 @@ void Generate_TypeDeclaration(Trees_Node ident)
 		}
 		GenerateTypeDescDecl(typeDescIdent, indent);
 	}
+	Stats_Leave();
 }
 
 
@@ -842,6 +854,7 @@ void Generate_VariableDeclaration(Trees_Node identList)
 	int indent;
 
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 	GenerateInternalDeclarations(VAR_SECTION);
 
 	ident = Trees_Left(identList);
@@ -928,6 +941,7 @@ void Generate_VariableDeclaration(Trees_Node identList)
 	} else {
 		GenerateDeclaration(declaration, cFile, indent);
 	}
+	Stats_Leave();
 }
 
 
@@ -1133,11 +1147,86 @@ static int ContainsProcedureCall(Trees_Node exp)
 }
 
 
+static void GenerateCharArray(Trees_Node operand, Trees_Node type, FILE *file)
+{
+	if (Types_IsArray(type) && (ArrayDimension(operand) > 0)) {
+		fprintf(file, "&");
+	}
+	GenerateWithPrecedence(operand, file);
+}
+
+
+static void GenerateComparison(Trees_Node opNode, Trees_Node operands[], Trees_Node types[], FILE *file)
+{
+	int i;
+
+	if (ContainsProcedureCall(operands[0]) || ContainsProcedureCall(operands[1])) {
+		fprintf(file, "OBNC_Cmp(");
+	} else {
+		fprintf(file, "OBNC_CMP(");
+	}
+	for (i = 0; i < 2; i++) {
+		if (i > 0) {
+			fprintf(file, ", ");
+		}
+		GenerateCharArray(operands[i], types[i], file);
+		fprintf(file, ", ");
+		if (Trees_Symbol(types[i]) == TREES_STRING_TYPE) {
+			fprintf(file, "%lu", (long unsigned int) strlen(Trees_String(operands[i])) + 1);
+		} else {
+			GenerateArrayLength(types[i], EntireVar(operands[i]), ArrayDimension(operands[i]), file);
+		}
+	}
+	fprintf(file, ") ");
+	PrintCOperator(opNode, file);
+	fprintf(file, " 0");
+}
+
+
+/*generates a test for equality of a character array with at least as many elements as there are characters in literal, including the terminator*/
+static void GenerateLiteralEquality(Trees_Node opNode, Trees_Node array, Trees_Node arrayType, const char literal[], FILE *file)
+{
+	int n, j;
+
+	n = (int) strlen(literal) + 1;
+	if (n <= 4) {
+		/*unrolled comparison which stops at the first differing character*/
+		if (Trees_Symbol(opNode) == '#') {
+			fprintf(file, "! ");
+		}
+		fprintf(file, "(");
+		for (j = 0; j < n; j++) {
+			if (j > 0) {
+				fprintf(file, " && ");
+			}
+			if (ArrayDimension(array) > 0) {
+				fprintf(file, "(");
+				GenerateCharArray(array, arrayType, file);
+				fprintf(file, ")");
+			} else {
+				GenerateWithPrecedence(array, file);
+			}
+			fprintf(file, "[%d] == ", j);
+			GenerateChar(literal[j], file);
+		}
+		fprintf(file, ")");
+	} else {
+		fprintf(file, "memcmp(");
+		GenerateCharArray(array, arrayType, file);
+		fprintf(file, ", ");
+		GenerateString(literal, file);
+		fprintf(file, ", %d) ", n);
+		PrintCOperator(opNode, file);
+		fprintf(file, " 0");
+	}
+}
+
+
 static void GenerateNonScalarOperation(Trees_Node opNode, FILE *file, int indent)
 {
 	Trees_Node operands[2];
 	Trees_Node types[2];
-	int i;
+	int literalPos, arrayPos, n;
 
 	operands[0] = Trees_Left(opNode);
 	operands[1] = Trees_Right(opNode);
@@ -1152,29 +1241,30 @@ static void GenerateNonScalarOperation(Trees_Node opNode, FILE *file, int indent
 		case '>':
 		case GE:
 			Indent(file, indent);
-			if (ContainsProcedureCall(operands[0]) || ContainsProcedureCall(operands[1])) {
-				fprintf(file, "OBNC_Cmp(");
-			} else {
-				fprintf(file, "OBNC_CMP(");
-			}
-			for (i = 0; i < 2; i++) {
-				if (i > 0) {
-					fprintf(file, ", ");
-				}
-				if (Types_IsArray(types[i]) && (ArrayDimension(operands[i]) > 0)) {
-					fprintf(file, "&");
-				}
-				GenerateWithPrecedence(operands[i], file);
-				fprintf(file, ", ");
-				if (Trees_Symbol(types[i]) == TREES_STRING_TYPE) {
-					fprintf(file, "%lu", (long unsigned int) strlen(Trees_String(operands[i])) + 1);
+			literalPos = (Trees_Symbol(types[0]) == TREES_STRING_TYPE)? 0: 1;
+			arrayPos = 1 - literalPos;
+			if (((Trees_Symbol(opNode) == '=') || (Trees_Symbol(opNode) == '#'))
+					&& (Trees_Symbol(types[literalPos]) == TREES_STRING_TYPE)
+					&& Types_IsArray(types[arrayPos])
+					&& ! ContainsProcedureCall(operands[arrayPos])) {
+				/*equality with a string literal is decided by the characters up to its terminator*/
+				n = (int) strlen(Trees_String(operands[literalPos])) + 1;
+				if (Types_IsOpenArray(types[arrayPos])) {
+					fprintf(file, "((");
+					GenerateArrayLength(types[arrayPos], EntireVar(operands[arrayPos]), ArrayDimension(operands[arrayPos]), file);
+					fprintf(file, " >= %d)? ", n);
+					GenerateLiteralEquality(opNode, operands[arrayPos], types[arrayPos], Trees_String(operands[literalPos]), file);
+					fprintf(file, ": ");
+					GenerateComparison(opNode, operands, types, file);
+					fprintf(file, ")");
+				} else if (Trees_Integer(Types_ArrayLength(types[arrayPos])) >= n) {
+					GenerateLiteralEquality(opNode, operands[arrayPos], types[arrayPos], Trees_String(operands[literalPos]), file);
 				} else {
-					GenerateArrayLength(types[i], EntireVar(operands[i]), ArrayDimension(operands[i]), file);
+					GenerateComparison(opNode, operands, types, file);
 				}
+			} else {
+				GenerateComparison(opNode, operands, types, file);
 			}
-			fprintf(file, ") ");
-			PrintCOperator(opNode, file);
-			fprintf(file, " 0");
 			break;
 		default:
 			assert(0);
@@ -1377,7 +1467,8 @@ static void GenerateArrayIndex(Trees_Node var, Trees_Node indexSelector, FILE *f
 			fprintf(file, " + ");
 		}
 		indexExp = Trees_Left(selector);
-		trapNeeded = Types_IsOpenArray(arrayType) || ! IsConstExpression(indexExp);
+		trapNeeded = (Types_IsOpenArray(arrayType) || ! IsConstExpression(indexExp))
+			&& ! Intervals_IsIndex(indexExp, currArrayType, EntireVar(var), dim);
 		if (trapNeeded) {
 			if (ContainsProcedureCall(indexExp)) {
 				fprintf(file, "OBNC_IT1(");
@@ -1657,6 +1748,46 @@ static void GenerateRecordAssignment(Trees_Node source, Trees_Node target, FILE
 }
 
 
+static int References(Trees_Node node, Trees_Node ident)
+{
+	return (node != NULL)
+		&& ((node == ident) || References(Trees_Left(node), ident) || References(Trees_Right(node), ident));
+}
+
+
+/*returns true if statement is an array or record assignment to an entire variable which the next statement overwrites before it is read*/
+static int IsOverwritten(Trees_Node statement, Trees_Node nextStatements)
+{
+	Trees_Node target, source, var, next, nextSource;
+	int result;
+
+	result = 0;
+	if ((Trees_Symbol(statement) == BECOMES) && (nextStatements != NULL)
+			&& (Trees_Symbol(Trees_Left(nextStatements)) == BECOMES)) {
+		target = Trees_Left(statement);
+		source = Trees_Right(statement);
+		var = EntireVar(target);
+		next = Trees_Left(nextStatements);
+		nextSource = Trees_Right(next);
+		result = (NextSelector(target) == NULL)
+			&& (Trees_Kind(var) == TREES_VARIABLE_KIND)
+			&& (Types_IsArray(Trees_Type(var)) || Types_IsRecord(Trees_Type(var)))
+			/*the source cannot trap or have side effects*/
+			&& ((Trees_Symbol(source) == STRING)
+				|| ((Trees_Symbol(source) == TREES_DESIGNATOR) && (NextSelector(source) == NULL)
+					&& ! Types_IsOpenArray(Trees_Type(source))))
+			/*the next statement assigns all of the variable, and a string or an open array may be shorter*/
+			&& (Trees_Symbol(Trees_Left(next)) == TREES_DESIGNATOR)
+			&& (EntireVar(Trees_Left(next)) == var) && (NextSelector(Trees_Left(next)) == NULL)
+			&& (Trees_Symbol(nextSource) != STRING) && ! Types_IsOpenArray(Trees_Type(nextSource))
+			/*the variable is local, so only the next statement itself can read it, and a trap unwinds it*/
+			&& Trees_Local(var)
+			&& ! References(nextSource, var);
+	}
+	return result;
+}
+
+
 static int CastNeeded(Trees_Node sourceType, Trees_Node targetType)
 {
 	return (Types_IsByte(targetType) && ! Types_IsByte(sourceType))
@@ -1986,7 +2117,9 @@ static void GenerateForStatement(Trees_Node forNode, FILE *file, int indent)
 	fprintf(file, "; ");
 	Generate(controlVarNode, file, 0);
 	fprintf(file, " += %" OBNC_INT_MOD "d) {\n", inc);
+	Intervals_EnterFor(forNode);
 	Generate(statementSeq, file, indent + 1);
+	Intervals_LeaveFor(forNode);
 	Indent(file, indent);
 	fprintf(file, "}\n");
 }
@@ -2260,6 +2393,7 @@ void Generate_ProcedureHeading(Trees_Node procIdent)
 	Trees_Node procType, resultType, paramList;
 
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 	GenerateInternalDeclarations(PROCEDURE_SECTION);
 
 	PushProcedureDeclaration(procIdent);
@@ -2302,14 +2436,17 @@ void Generate_ProcedureHeading(Trees_Node procIdent)
 	}
 
 	fprintf(cFile, "\n{\n");
+	Stats_Leave();
 }
 
 
 void Generate_ProcedureStatements(Trees_Node stmtSeq)
 {
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 	fprintf(cFile, "\n");
 	Generate(stmtSeq, cFile, 1);
+	Stats_Leave();
 }
 
 
@@ -2318,6 +2455,7 @@ void Generate_ReturnClause(Trees_Node exp)
 	Trees_Node resultType;
 
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 	assert(procedureDeclStack != NULL);
 
 	resultType = Types_ResultType(Trees_Type(procedureDeclStack->procIdent));
@@ -2331,15 +2469,18 @@ void Generate_ReturnClause(Trees_Node exp)
 	}
 	Generate(exp, cFile, 0);
 	fprintf(cFile, ";\n");
+	Stats_Leave();
 }
 
 
 void Generate_ProcedureEnd(Trees_Node procIdent)
 {
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 	(void) procIdent; /*prevent "unused" warning*/
 	fprintf(cFile, "}\n\n");
 	PopProcedureDeclaration();
+	Stats_Leave();
 }
 
 
@@ -2400,9 +2541,113 @@ static void DeleteTemporaryFiles(void)
 }
 
 
+static int CheckMode(const char name[], int nameLen)
+{
+	int result;
+
+	result = LEN(checkModes) - 1;
+	while ((result > GENERATE_CHECKS_DEFAULT)
+			&& ! ((strncmp(checkModes[result], name, nameLen) == 0) && (checkModes[result][nameLen] == '\0'))) {
+		result--;
+	}
+	return result;
+}
+
+
+int Generate_SetChecks(const char spec[])
+{
+	const char *item, *colon, *end;
+	int ok, family, mode, i;
+
+	assert(initialized);
+	assert(spec != NULL);
+
+	ok = 1;
+	item = spec;
+	do {
+		end = strchr(item, ',');
+		if (end == NULL) {
+			end = item + strlen(item);
+		}
+		colon = memchr(item, ':', end - item);
+		ok = colon != NULL;
+		if (ok) {
+			mode = CheckMode(colon + 1, end - colon - 1);
+			ok = mode != GENERATE_CHECKS_DEFAULT;
+		}
+		if (ok) {
+			if ((colon - item == 3) && (strncmp(item, "all", 3) == 0)) {
+				for (i = 0; i < LEN(checks); i++) {
+					checks[i] = mode;
+				}
+			} else {
+				family = LEN(checkFamilies) - 1;
+				while ((family >= 0)
+						&& ! ((strncmp(checkFamilies[family], item, colon - item) == 0) && (checkFamilies[family][colon - item] == '\0'))) {
+					family--;
+				}
+				ok = family >= 0;
+				if (ok) {
+					checks[family] = mode;
+				}
+			}
+		}
+		item = end + 1;
+	} while (ok && (*end != '\0'));
+	return ok;
+}
+
+
+static const char *ChecksSpec(void) /*normalized spec of the selected checks, or the empty string if no checks are selected*/
+{
+	const char *result;
+	int i;
+
+	result = "";
+	for (i = 0; i < LEN(checks); i++) {
+		if (checks[i] != GENERATE_CHECKS_DEFAULT) {
+			result = Util_String("%s%s%s:%s", result, (result[0] != '\0')? ",": "", checkFamilies[i], checkModes[checks[i]]);
+		}
+	}
+	return result;
+}
+
+
+static void GenerateCheckConfiguration(void) /*defines the OBNC_CONFIG_NO_<FAMILY>_CHECKS constants before OBNC.h is included*/
+{
+	const char *constant;
+	int i;
+
+	for (i = 0; i < LEN(checks); i++) {
+		if (checks[i] != GENERATE_CHECKS_DEFAULT) {
+			constant = checkConstants[i];
+			fprintf(cFile, "#undef %s\n", constant);
+			switch (checks[i]) {
+				case GENERATE_CHECKS_ON:
+					fprintf(cFile, "#define %s 0\n", constant);
+					break;
+				case GENERATE_CHECKS_OFF:
+					fprintf(cFile, "#define %s 1\n", constant);
+					break;
+				case GENERATE_CHECKS_DEBUG:
+					fprintf(cFile, "#ifdef NDEBUG\n");
+					fprintf(cFile, "#define %s 1\n", constant);
+					fprintf(cFile, "#else\n");
+					fprintf(cFile, "#define %s 0\n", constant);
+					fprintf(cFile, "#endif\n");
+					break;
+				default:
+					assert(0);
+			}
+		}
+	}
+}
+
+
 void Generate_Open(const char inputFile[], int isEntryPoint)
 {
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 
 	inputFilename = inputFile;
 	inputModuleName = Paths_SansSuffix(Paths_Basename(inputFile));
@@ -2429,21 +2674,36 @@ void Generate_Open(const char inputFile[], int isEntryPoint)
 	hFile = Files_New(tempHFilepath);
 
 	atexit(DeleteTemporaryFiles);
+	Stats_Leave();
 }
 
 
 void Generate_ModuleHeading(void)
 {
+	const char *checksSpec;
+
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 
 	fprintf(cFile, "%s\n\n", headerComment);
+	checksSpec = ChecksSpec();
+	if (checksSpec[0] != '\0') {
+		fprintf(cFile, "/*compiled with --checks=%s*/\n", checksSpec);
+		GenerateCheckConfiguration();
+		fprintf(cFile, "\n");
+	}
 	if (! isEntryPointModule) {
 		fprintf(cFile, "#include \"%s.h\"\n", inputModuleName);
 	}
 
 	fprintf(hFile, "%s\n\n", headerComment);
+	if (checksSpec[0] != '\0') {
+		/*make the runtime checks of the module visible to clients*/
+		fprintf(hFile, "/*compiled with --checks=%s*/\n\n", checksSpec);
+	}
 	fprintf(hFile, "#ifndef %s_h\n", inputModuleName);
 	fprintf(hFile, "#define %s_h\n\n", inputModuleName);
+	Stats_Leave();
 }
 
 
@@ -2492,6 +2752,7 @@ void Generate_ImportList(Trees_Node list)
 	const char *dirPath, *parentDirPrefix, *relativePath;
 
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 	importList = list;
 
 	while (list != NULL) {
@@ -2526,6 +2787,7 @@ void Generate_ImportList(Trees_Node list)
 		}
 		list = Trees_Right(list);
 	}
+	Stats_Leave();
 }
 
 
@@ -2561,6 +2823,7 @@ void Generate_ModuleStatements(Trees_Node stmtSeq)
 	Trees_Node initFuncIdent;
 
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 
 	GenerateInternalDeclarations(MODULE_SECTION);
 	SearchAddressOperations(stmtSeq);
@@ -2614,13 +2877,16 @@ void Generate_ModuleStatements(Trees_Node stmtSeq)
 		GenerateObjectFileSymbolDefinitions(Trees_NewNode(TREES_NOSYM, initFuncIdent, NULL), "", hFile, 0);
 		fprintf(hFile, "void %s(void);\n", initFuncName);
 	}
+	Stats_Leave();
 }
 
 
 void Generate_ModuleEnd(void)
 {
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 	fprintf(hFile, "\n#endif\n");
+	Stats_Leave();
 }
 
 
@@ -2629,6 +2895,7 @@ void Generate_Close(void)
 	const char *cFilepath, *hFilepath;
 
 	assert(initialized);
+	Stats_Enter(STATS_GENERATION);
 
 	/*close temporary files*/
 	Files_Close(&cFile);
@@ -2663,6 +2930,7 @@ void Generate_Close(void)
 			exit(EXIT_FAILURE);
 		}
 	}
+	Stats_Leave();
 }
 
 
@@ -3015,7 +3283,9 @@ static void Generate(Trees_Node node, FILE *file, int indent)
 				fprintf(file, ")");
 				break;
 			case TREES_STATEMENT_SEQUENCE:
-				Generate(Trees_Left(node), file, indent);
+				if (! IsOverwritten(Trees_Left(node), Trees_Right(node))) {
+					Generate(Trees_Left(node), file, indent);
+				}
 				Generate(Trees_Right(node), file, indent);
 				break;
 			case TREES_UNPK_PROC:
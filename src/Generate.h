@@ -20,8 +20,24 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 
 #include "Trees.h"
 
+/*families of runtime checks*/
+#define GENERATE_INDEX_CHECKS 0
+#define GENERATE_POINTER_CHECKS 1
+#define GENERATE_CALL_CHECKS 2
+#define GENERATE_GUARD_CHECKS 3
+#define GENERATE_ASSIGNMENT_CHECKS 4
+
+/*check modes*/
+#define GENERATE_CHECKS_DEFAULT 0 /*as configured with OBNC_CONFIG_NO_<FAMILY>_CHECKS*/
+#define GENERATE_CHECKS_ON 1
+#define GENERATE_CHECKS_OFF 2
+#define GENERATE_CHECKS_DEBUG 3 /*on unless NDEBUG is defined*/
+
 void Generate_Init(void);
 
+/*Selects the runtime checks from spec, a comma-separated list of FAMILY:MODE where FAMILY is index, pointer, call, guard, assignment or all and MODE is on, off or debug. Returns false if spec is invalid. Must be called before Generate_Open.*/
+int Generate_SetChecks(const char spec[]);
+
 void Generate_Open(const char inputFile[], int isEntryPoint);
 
 void Generate_ModuleHeading(void);
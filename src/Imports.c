@@ -0,0 +1,225 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#include "Imports.h"
+#include "Util.h"
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*This is a minimal version of the lexer and the grammar rules for the module heading and the import list in Oberon.l and Oberon.y. Anything the compiler would reject, or which is not needed to tell the import list, makes Imports_Read fail.*/
+
+#define WORD_LEN 256
+
+enum { WORD_TOKEN = 256, BECOMES_TOKEN, ERROR_TOKEN };
+
+/*keywords in Oberon.l*/
+static const char *keywords[] = {"ARRAY", "BEGIN", "BY", "CASE", "CONST", "DIV", "DO", "ELSE", "ELSIF", "END", "FALSE", "FOR", "IF", "IMPORT", "IN", "IS", "MOD", "MODULE", "NIL", "OF", "OR", "POINTER", "PROCEDURE", "RECORD", "REPEAT", "RETURN", "THEN", "TO", "TRUE", "TYPE", "UNTIL", "VAR", "WHILE"};
+
+/*predeclared identifiers in Table.c, which cannot be used as qualifiers*/
+static const char *predeclaredNames[] = {"ABS", "ASR", "ASSERT", "BOOLEAN", "BYTE", "CHAR", "CHR", "DEC", "EXCL", "FLOOR", "FLT", "INC", "INCL", "INTEGER", "LEN", "LSL", "NEW", "ODD", "ORD", "PACK", "REAL", "ROR", "SET", "UNPK"};
+
+static int Member(const char s[], const char *set[], int setLen)
+{
+	int i;
+
+	i = 0;
+	while ((i < setLen) && (strcmp(set[i], s) != 0)) {
+		i++;
+	}
+	return i < setLen;
+}
+
+
+static int IsLetter(int ch)
+{
+	return ((ch >= 'A') && (ch <= 'Z')) || ((ch >= 'a') && (ch <= 'z'));
+}
+
+
+static int IsDigit(int ch)
+{
+	return (ch >= '0') && (ch <= '9');
+}
+
+
+static int SkipComment(FILE *file) /*after "(*"*/
+{
+	int level, ch, prev;
+
+	level = 1;
+	prev = ' ';
+	ch = getc(file);
+	while ((level > 0) && (ch != EOF)) {
+		if ((prev == '(') && (ch == '*')) {
+			level++;
+			ch = ' '; /*the star cannot also end a comment*/
+		} else if ((prev == '*') && (ch == ')')) {
+			level--;
+			ch = ' ';
+		}
+		if (level > 0) {
+			prev = ch;
+			ch = getc(file);
+		}
+	}
+	return level == 0;
+}
+
+
+/*returns true iff the lexer would accept the characters in word as a single identifier or keyword*/
+static int ValidWord(const char word[], int len)
+{
+	int i;
+
+	i = 1;
+	while ((i < len) && ! ((word[i] == '_') && ((i == len - 1) || (word[i + 1] == '_')))) {
+		i++;
+	}
+	return i == len;
+}
+
+
+static int Token(FILE *file, char word[])
+{
+	int token, ch, len;
+
+	token = 0;
+	do {
+		ch = getc(file);
+		if ((ch == ' ') || (ch == '\t') || (ch == '\r') || (ch == '\n')) {
+			/*skip white space*/
+		} else if (ch == '(') {
+			ch = getc(file);
+			if (ch == '*') {
+				if (! SkipComment(file)) {
+					token = ERROR_TOKEN;
+				}
+			} else {
+				token = '(';
+			}
+		} else if (IsLetter(ch)) {
+			len = 0;
+			while ((IsLetter(ch) || IsDigit(ch) || (ch == '_')) && (len < WORD_LEN - 1)) {
+				word[len] = (char) ch;
+				len++;
+				ch = getc(file);
+			}
+			word[len] = '\0';
+			ungetc(ch, file);
+			token = ((len < WORD_LEN - 1) && ValidWord(word, len))? WORD_TOKEN: ERROR_TOKEN;
+		} else if (ch == ':') {
+			token = (getc(file) == '=')? BECOMES_TOKEN: ERROR_TOKEN;
+		} else if ((ch == ',') || (ch == ';')) {
+			token = ch;
+		} else {
+			token = ERROR_TOKEN;
+		}
+	} while (token == 0);
+	return token;
+}
+
+
+static int Ident(int token, const char word[])
+{
+	return (token == WORD_TOKEN) && ! Member(word, keywords, LEN(keywords));
+}
+
+
+int Imports_Read(FILE *file, const char module[], char ***importedModules, int *importedModulesLen)
+{
+	char word[WORD_LEN];
+	char *qualifier, *importedModule;
+	char **qualifiers, **result;
+	int token, ok, qualifiersLen, qualifiersCap, resultLen, resultCap;
+
+	assert(file != NULL);
+	assert(module != NULL);
+
+	qualifiersCap = 8;
+	NEW_ARRAY(qualifiers, qualifiersCap);
+	qualifiersLen = 0;
+	resultCap = 8;
+	NEW_ARRAY(result, resultCap);
+	resultLen = 0;
+
+	/*module heading*/
+	ok = (Token(file, word) == WORD_TOKEN) && (strcmp(word, "MODULE") == 0)
+		&& Ident(Token(file, word), word) && (strcmp(word, module) == 0)
+		&& (Token(file, word) == ';');
+
+	/*import list*/
+	if (ok) {
+		token = Token(file, word);
+		if ((token == WORD_TOKEN) && (strcmp(word, "IMPORT") == 0)) {
+			do {
+				importedModule = NULL;
+				token = Token(file, word);
+				ok = Ident(token, word);
+				if (ok) {
+					qualifier = Util_String("%s", word);
+					token = Token(file, word);
+					if (token == BECOMES_TOKEN) {
+						token = Token(file, word);
+						ok = Ident(token, word);
+						if (ok) {
+							importedModule = Util_String("%s", word);
+							token = Token(file, word);
+						}
+					} else {
+						importedModule = qualifier;
+					}
+				}
+				if (ok) {
+					ok = (strcmp(importedModule, module) != 0)
+						&& ! Member(qualifier, (const char **) qualifiers, qualifiersLen)
+						&& ! Member(qualifier, predeclaredNames, LEN(predeclaredNames));
+				}
+				if (ok) {
+					if (qualifiersLen >= qualifiersCap) {
+						qualifiersCap *= 2;
+						RENEW_ARRAY(qualifiers, qualifiersCap);
+					}
+					qualifiers[qualifiersLen] = qualifier;
+					qualifiersLen++;
+
+					/*like the compiler, list each module once and leave out SYSTEM*/
+					if ((strcmp(importedModule, "SYSTEM") != 0) && ! Member(importedModule, (const char **) result, resultLen)) {
+						if (resultLen >= resultCap) {
+							resultCap *= 2;
+							RENEW_ARRAY(result, resultCap);
+						}
+						result[resultLen] = importedModule;
+						resultLen++;
+					}
+				}
+			} while (ok && (token == ','));
+			ok = ok && (token == ';');
+		} else {
+			/*without an import list, the heading is followed by a declaration or a statement sequence*/
+			ok = token == WORD_TOKEN;
+		}
+	}
+
+	if (ok) {
+		*importedModules = result;
+		*importedModulesLen = resultLen;
+	}
+	return ok;
+}
@@ -0,0 +1,26 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#ifndef IMPORTS_H
+#define IMPORTS_H
+
+#include <stdio.h>
+
+/*Reads the names of the modules imported by the module in file and sets *importedModules to them in import order, as printed by obnc-compile -l. Only the module heading and the import list are read. Returns false if the heading is not well-formed, in which case the compiler is needed to report the error.*/
+int Imports_Read(FILE *file, const char module[], char ***importedModules, int *importedModulesLen);
+
+#endif
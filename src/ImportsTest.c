@@ -0,0 +1,107 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#include "Imports.h"
+#include "Util.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*reads the import list of module M in source and compares it with the comma-separated list expected, or returns false if the import list could not be read*/
+static int ImportsMatch(const char source[], const char expected[])
+{
+	FILE *file;
+	char **modules;
+	int modulesLen, done, i;
+	const char *list;
+
+	file = tmpfile();
+	assert(file != NULL);
+	fputs(source, file);
+	rewind(file);
+	done = Imports_Read(file, "M", &modules, &modulesLen);
+	fclose(file);
+
+	if (done) {
+		list = "";
+		for (i = 0; i < modulesLen; i++) {
+			list = Util_String("%s%s%s", list, (i > 0)? ",": "", modules[i]);
+		}
+		if (strcmp(list, expected) != 0) {
+			fprintf(stderr, "ImportsTest: got \"%s\", expected \"%s\"\n", list, expected);
+			done = 0;
+		}
+	}
+	return done;
+}
+
+
+static void TestValidModules(void)
+{
+	assert(ImportsMatch("MODULE M; END M.", ""));
+	assert(ImportsMatch("MODULE M;\nBEGIN\nEND M.", ""));
+	assert(ImportsMatch("MODULE M; IMPORT A; END M.", "A"));
+	assert(ImportsMatch("MODULE M;\n\tIMPORT A, B,\n\t\tC;\nEND M.", "A,B,C"));
+	assert(ImportsMatch("(*header*) MODULE (*name:*) M (*; IMPORT X;*); IMPORT (*(*nested*) A, *) B; END M.", "B"));
+	assert(ImportsMatch("(**) MODULE M; IMPORT A (***); (*)*)", "A"));
+	assert(ImportsMatch("MODULE M; IMPORT Out_2, ext_Lib1; END M.", "Out_2,ext_Lib1"));
+	assert(ImportsMatch("MODULE M; IMPORT A; (* the rest of the module is not read", "A"));
+}
+
+
+static void TestAliases(void)
+{
+	assert(ImportsMatch("MODULE M; IMPORT X := A; END M.", "A"));
+	assert(ImportsMatch("MODULE M; IMPORT X := A, Y := A, A; END M.", "A"));
+	assert(ImportsMatch("MODULE M; IMPORT B, X := A, Y := B; END M.", "B,A"));
+	assert(ImportsMatch("MODULE M; IMPORT SYSTEM, S := SYSTEM, A; END M.", "A"));
+	assert(ImportsMatch("MODULE M; IMPORT M := A; END M.", "A"));
+}
+
+
+static void TestInvalidModules(void)
+{
+	assert(! ImportsMatch("", ""));
+	assert(! ImportsMatch("MODULE N; END N.", ""));
+	assert(! ImportsMatch("MODULE M IMPORT A; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT ; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT A B; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT A,; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT A := ; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT A", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT M; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT X := M; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT A, A; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT X := A, X := B; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT INTEGER; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT END; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT A_; END M.", ""));
+	assert(! ImportsMatch("MODULE M; IMPORT A__B; END M.", ""));
+	assert(! ImportsMatch("MODULE M; (* IMPORT A; END M.", ""));
+	assert(! ImportsMatch("MODULE M; 1 END M.", ""));
+}
+
+
+int main(void)
+{
+	Util_Init();
+	TestValidModules();
+	TestAliases();
+	TestInvalidModules();
+	return 0;
+}
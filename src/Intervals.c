@@ -0,0 +1,373 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#include "Intervals.h"
+#include "Trees.h"
+#include "Types.h"
+#include "Util.h"
+#include "../lib/obnc/OBNC.h"
+#include "y.tab.h"
+#include <assert.h>
+#include <stdlib.h>
+
+typedef struct {
+	OBNC_INTEGER min, max;
+	Trees_Node lenVar; /*if not NULL, max is relative to the length of open array lenVar*/
+} Interval;
+
+typedef struct ForRangeDesc *ForRange;
+
+struct ForRangeDesc {
+	Trees_Node forNode, controlVar;
+	int known;
+	Interval range;
+	ForRange next;
+};
+
+static int initialized = 0;
+static ForRange forRanges; /*stack of enclosing FOR statements*/
+
+void Intervals_Init(void)
+{
+	if (! initialized) {
+		initialized = 1;
+		Trees_Init();
+		Util_Init();
+	}
+}
+
+
+static int Sum(OBNC_INTEGER a, OBNC_INTEGER b, OBNC_INTEGER *result)
+{
+	int done;
+
+	done = ((b >= 0) && (a <= OBNC_INT_MAX - b)) || ((b < 0) && (a >= -OBNC_INT_MAX - b));
+	if (done) {
+		*result = a + b;
+	}
+	return done;
+}
+
+
+static int Product(OBNC_INTEGER a, OBNC_INTEGER b, OBNC_INTEGER *result)
+{
+	int done;
+
+	done = (a == 0) || (b == 0) || (labs(a) <= OBNC_INT_MAX / labs(b));
+	if (done) {
+		*result = a * b;
+	}
+	return done;
+}
+
+
+static int IsVar(Trees_Node exp, Trees_Node var)
+{
+	return (Trees_Symbol(exp) == TREES_DESIGNATOR) && (Trees_Left(exp) == var) && (Trees_Right(exp) == NULL);
+}
+
+
+static Trees_Node OpenArrayOfLength(Trees_Node lenCall)
+{
+	Trees_Node var, result;
+
+	result = NULL;
+	var = Trees_Left(Trees_Left(lenCall));
+	if ((Trees_Symbol(var) == TREES_DESIGNATOR) && (Trees_Right(var) == NULL) && Types_IsOpenArray(Trees_Type(var))) {
+		result = Trees_Left(var);
+	}
+	return result;
+}
+
+
+static int Get(Trees_Node exp, Interval *range);
+
+static int GetOperation(Trees_Node exp, Interval *range)
+{
+	Interval left, right;
+	OBNC_INTEGER bounds[4], divisor;
+	int done, i;
+
+	done = 0;
+	if (Trees_Right(exp) == NULL) {
+		if (Get(Trees_Left(exp), &left) && (left.lenVar == NULL)) {
+			done = 1;
+			if (Trees_Symbol(exp) == '-') {
+				range->min = -left.max;
+				range->max = -left.min;
+				range->lenVar = NULL;
+			} else if (Trees_Symbol(exp) == '+') {
+				*range = left;
+			} else {
+				done = 0;
+			}
+		}
+	} else if ((Trees_Symbol(exp) == DIV) || (Trees_Symbol(exp) == MOD)) {
+		if ((Trees_Symbol(Trees_Right(exp)) == INTEGER) && (Trees_Integer(Trees_Right(exp)) > 0)) {
+			divisor = Trees_Integer(Trees_Right(exp));
+			done = Get(Trees_Left(exp), &left) && (left.lenVar == NULL);
+			if (Trees_Symbol(exp) == DIV) {
+				if (done) {
+					range->min = OBNC_DIV(left.min, divisor);
+					range->max = OBNC_DIV(left.max, divisor);
+					range->lenVar = NULL;
+				}
+			} else if (done && (left.min >= 0) && (left.max < divisor)) {
+				*range = left;
+			} else {
+				done = 1;
+				range->min = 0;
+				range->max = divisor - 1;
+				range->lenVar = NULL;
+			}
+		}
+	} else if (Get(Trees_Left(exp), &left) && Get(Trees_Right(exp), &right)) {
+		switch (Trees_Symbol(exp)) {
+			case '+':
+				done = ((left.lenVar == NULL) || (right.lenVar == NULL))
+					&& Sum(left.min, right.min, &range->min)
+					&& Sum(left.max, right.max, &range->max);
+				range->lenVar = (left.lenVar != NULL)? left.lenVar: right.lenVar;
+				break;
+			case '-':
+				done = (right.lenVar == NULL)
+					&& Sum(left.min, -right.max, &range->min)
+					&& Sum(left.max, -right.min, &range->max);
+				range->lenVar = left.lenVar;
+				break;
+			case '*':
+				done = (left.lenVar == NULL) && (right.lenVar == NULL)
+					&& Product(left.min, right.min, &bounds[0])
+					&& Product(left.min, right.max, &bounds[1])
+					&& Product(left.max, right.min, &bounds[2])
+					&& Product(left.max, right.max, &bounds[3]);
+				if (done) {
+					range->min = bounds[0];
+					range->max = bounds[0];
+					for (i = 1; i < 4; i++) {
+						if (bounds[i] < range->min) {
+							range->min = bounds[i];
+						} else if (bounds[i] > range->max) {
+							range->max = bounds[i];
+						}
+					}
+					range->lenVar = NULL;
+				}
+				break;
+		}
+	}
+	return done;
+}
+
+
+static int Get(Trees_Node exp, Interval *range)
+{
+	Trees_Node param;
+	ForRange curr;
+	int done;
+
+	done = 0;
+	switch (Trees_Symbol(exp)) {
+		case INTEGER:
+			done = Trees_Integer(exp) >= -OBNC_INT_MAX;
+			range->min = Trees_Integer(exp);
+			range->max = Trees_Integer(exp);
+			range->lenVar = NULL;
+			break;
+		case TREES_DESIGNATOR:
+			if (Trees_Right(exp) == NULL) {
+				curr = forRanges;
+				while ((curr != NULL) && (curr->controlVar != Trees_Left(exp))) {
+					curr = curr->next;
+				}
+				if ((curr != NULL) && curr->known) {
+					done = 1;
+					*range = curr->range;
+				}
+			}
+			break;
+		case TREES_LEN_PROC:
+			range->lenVar = OpenArrayOfLength(exp);
+			if (range->lenVar != NULL) {
+				done = 1;
+				range->min = 0;
+				range->max = 0;
+			}
+			break;
+		case TREES_ORD_PROC:
+			param = Trees_Left(Trees_Left(exp));
+			if (Types_IsChar(Trees_Type(param))) {
+				done = 1;
+				range->max = 255;
+			} else if (Types_IsBoolean(Trees_Type(param))) {
+				done = 1;
+				range->max = 1;
+			}
+			range->min = 0;
+			range->lenVar = NULL;
+			break;
+		case '+':
+		case '-':
+		case '*':
+		case DIV:
+		case MOD:
+			done = GetOperation(exp, range);
+			break;
+	}
+	if (! done && (Trees_Type(exp) != NULL) && Types_IsByte(Trees_Type(exp))) {
+		done = 1;
+		range->min = 0;
+		range->max = 255;
+		range->lenVar = NULL;
+	}
+	return done;
+}
+
+
+/*returns true if an assignment to target may change a global variable through a variable parameter or vice versa*/
+static int MayAlias(Trees_Node target)
+{
+	Trees_Node ident;
+
+	ident = (Trees_Symbol(target) == TREES_DESIGNATOR)? Trees_Left(target): target;
+	return ! Trees_Local(ident) || (Trees_Kind(ident) == TREES_VAR_PARAM_KIND);
+}
+
+
+/*returns true if node may change the value of variable var; a procedure call, or an assignment to a global variable or a variable parameter, may change it unless var is a local variable which is not passed as a variable parameter*/
+static int MayChange(Trees_Node node, Trees_Node var, int isLocal)
+{
+	Trees_Node expList, fpList;
+	int result;
+
+	result = 0;
+	if (node != NULL) {
+		switch (Trees_Symbol(node)) {
+			case BECOMES:
+				result = (Trees_Left(node) == var) || IsVar(Trees_Left(node), var)
+					|| (! isLocal && MayAlias(Trees_Left(node)));
+				break;
+			case TREES_INC_PROC:
+			case TREES_DEC_PROC:
+			case TREES_GET_PROC:
+			case TREES_UNPK_PROC:
+				expList = Trees_Left(node);
+				while ((expList != NULL) && ! result) {
+					result = IsVar(Trees_Left(expList), var)
+						|| (! isLocal && (Trees_Symbol(Trees_Left(expList)) == TREES_DESIGNATOR) && MayAlias(Trees_Left(expList)));
+					expList = Trees_Right(expList);
+				}
+				break;
+			case TREES_PUT_PROC:
+			case TREES_COPY_PROC:
+				result = 1;
+				break;
+			case TREES_PROCEDURE_CALL:
+				if (isLocal) {
+					expList = Trees_Right(node);
+					fpList = Types_Parameters(Types_Structure(Trees_Type(Trees_Left(node))));
+					while ((expList != NULL) && (fpList != NULL) && ! result) {
+						result = (Trees_Kind(Trees_Left(fpList)) == TREES_VAR_PARAM_KIND) && IsVar(Trees_Left(expList), var);
+						expList = Trees_Right(expList);
+						fpList = Trees_Right(fpList);
+					}
+				} else {
+					result = 1;
+				}
+				break;
+		}
+		if (! result) {
+			result = MayChange(Trees_Left(node), var, isLocal) || MayChange(Trees_Right(node), var, isLocal);
+		}
+	}
+	return result;
+}
+
+
+void Intervals_EnterFor(Trees_Node forNode)
+{
+	Trees_Node initNode, toNode, byNode;
+	Interval init, limit;
+	OBNC_INTEGER inc, next;
+	ForRange forRange;
+	int isLocal;
+
+	assert(initialized);
+	assert(Trees_Symbol(forNode) == FOR);
+
+	initNode = Trees_Left(forNode);
+	toNode = Trees_Right(forNode);
+	byNode = Trees_Right(toNode);
+	inc = Trees_Integer(Trees_Left(byNode));
+
+	NEW(forRange);
+	forRange->forNode = forNode;
+	forRange->controlVar = Trees_Left(initNode);
+	isLocal = Trees_Local(forRange->controlVar)
+		&& ((Trees_Kind(forRange->controlVar) == TREES_VARIABLE_KIND) || (Trees_Kind(forRange->controlVar) == TREES_VALUE_PARAM_KIND));
+	/*the range is computed before the new entry hides an outer loop with the same control variable*/
+	forRange->known = (Trees_Kind(forRange->controlVar) != TREES_VAR_PARAM_KIND)
+		&& Get(Trees_Right(initNode), &init)
+		&& Get(Trees_Left(toNode), &limit)
+		&& ! MayChange(Trees_Right(byNode), forRange->controlVar, isLocal);
+	if (forRange->known) {
+		if (inc > 0) {
+			/*with a limit relative to LEN, the last increment cannot overflow if it does not pass the length*/
+			forRange->known = (init.lenVar == NULL) && Sum(limit.max, inc, &next) && ((limit.lenVar == NULL) || (next <= 0));
+			forRange->range.min = init.min;
+			forRange->range.max = limit.max;
+			forRange->range.lenVar = limit.lenVar;
+		} else {
+			forRange->known = (limit.lenVar == NULL) && Sum(limit.min, inc, &next);
+			forRange->range.min = limit.min;
+			forRange->range.max = init.max;
+			forRange->range.lenVar = init.lenVar;
+		}
+	}
+	forRange->next = forRanges;
+	forRanges = forRange;
+}
+
+
+void Intervals_LeaveFor(Trees_Node forNode)
+{
+	assert(initialized);
+	assert(forRanges != NULL);
+	assert(forRanges->forNode == forNode);
+
+	forRanges = forRanges->next;
+}
+
+
+int Intervals_IsIndex(Trees_Node exp, Trees_Node arrayType, Trees_Node arrayVar, int dim)
+{
+	Interval range;
+	int result;
+
+	assert(initialized);
+	assert(Types_IsArray(arrayType));
+
+	result = 0;
+	if (Get(exp, &range) && (range.min >= 0)) {
+		if (Types_IsOpenArray(arrayType)) {
+			result = (dim == 0) && (range.lenVar == arrayVar) && (range.max < 0);
+		} else {
+			result = (range.lenVar == NULL) && (range.max < Trees_Integer(Types_ArrayLength(arrayType)));
+		}
+	}
+	return result;
+}
@@ -0,0 +1,35 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#ifndef INTERVALS_H
+#define INTERVALS_H
+
+#include "Trees.h"
+
+/*Value-range analysis used by the code generator to leave out runtime checks. The range of an integer expression is derived from constants, from the types BYTE, CHAR and BOOLEAN and from the control variables of the enclosing FOR statements.*/
+
+void Intervals_Init(void);
+
+/*Makes the range of the control variable of forNode known until Intervals_LeaveFor is called, provided that the range is given by the initial value and the limit and the statements of the loop cannot change the variable.*/
+void Intervals_EnterFor(Trees_Node forNode);
+
+void Intervals_LeaveFor(Trees_Node forNode);
+
+/*Returns true if the integer expression exp is known to be a valid index for dimension dim of arrayType, the type of variable arrayVar.*/
+int Intervals_IsIndex(Trees_Node exp, Trees_Node arrayType, Trees_Node arrayVar, int dim);
+
+#endif
@@ -18,7 +18,9 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 #include "ModulePaths.h"
 #include "Config.h"
 #include "Files.h"
+#include "Maps.h"
 #include "Util.h"
+#include <dirent.h> /*POSIX*/
 #include <assert.h>
 #include <ctype.h>
 #include <stdio.h>
@@ -31,7 +33,15 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 	#define PATH_SEPARATOR ':'
 #endif
 
+/*Each directory searched for modules is listed once, and the names of its source and symbol files are kept sorted so that a lookup needs no system call. The files are not expected to be added or removed while a program runs, except for files generated in .obnc directories, which are only consulted for modules without a source file.*/
+
+typedef struct {
+	char **names;
+	int namesLen;
+} Directory;
+
 static int initialized = 0;
+static Maps_Map directories; /*directory path -> Directory*/
 
 void ModulePaths_Init(void)
 {
@@ -39,11 +49,82 @@ void ModulePaths_Init(void)
 		initialized = 1;
 		Config_Init();
 		Files_Init();
+		Maps_Init();
 		Util_Init();
+		directories = Maps_New();
 	}
 }
 
 
+static int IsModuleFilename(const char name[])
+{
+	static const char *suffixes[] = {".obn", ".Mod", ".mod", ".sym"};
+	const char *suffix;
+	int i;
+
+	suffix = strrchr(name, '.');
+	i = 0;
+	while ((suffix != NULL) && (i < LEN(suffixes)) && (strcmp(suffix, suffixes[i]) != 0)) {
+		i++;
+	}
+	return (suffix != NULL) && (suffix > name) && (i < LEN(suffixes));
+}
+
+
+static int CompareNames(const void *a, const void *b)
+{
+	return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+
+static Directory *NewDirectory(const char path[])
+{
+	Directory *result;
+	DIR *dir;
+	struct dirent *file;
+	int namesCap;
+
+	NEW(result);
+	result->names = NULL;
+	result->namesLen = 0;
+	dir = opendir(path);
+	if (dir != NULL) {
+		namesCap = 64;
+		NEW_ARRAY(result->names, namesCap);
+		file = readdir(dir);
+		while (file != NULL) {
+			if (IsModuleFilename(file->d_name)) {
+				if (result->namesLen >= namesCap) {
+					namesCap *= 2;
+					RENEW_ARRAY(result->names, namesCap);
+				}
+				result->names[result->namesLen] = Util_String("%s", file->d_name);
+				result->namesLen++;
+			}
+			file = readdir(dir);
+		}
+		closedir(dir);
+		qsort(result->names, (size_t) result->namesLen, sizeof result->names[0], CompareNames);
+	}
+	return result;
+}
+
+
+/*returns true iff the file named filename exists in directory dir*/
+static int Contains(const char dir[], const char filename[])
+{
+	Directory *entry;
+
+	entry = Maps_At(dir, directories);
+	if (entry == NULL) {
+		entry = NewDirectory(dir);
+		Maps_Put(dir, entry, &directories);
+	}
+	return (entry->namesLen > 0)
+		&& (bsearch(&filename, entry->names, (size_t) entry->namesLen, sizeof entry->names[0], CompareNames) != NULL);
+}
+
+
 static const char *AsPrefix(const char dir[])
 {
 	return (strcmp(dir, ".") == 0)? "": Util_String("%s/", dir);
@@ -54,17 +135,14 @@ const char *ModulePaths_SourceFile(const char module[], const char dir[])
 {
 	static const char *suffixes[] = {".obn", ".Mod", ".mod"};
 	int i;
-	const char *result;
 
 	assert(initialized);
 
-	i = -1;
-	do {
+	i = 0;
+	while ((i < LEN(suffixes)) && ! Contains(dir, Util_String("%s%s", module, suffixes[i]))) {
 		i++;
-		result = Util_String("%s%s%s", AsPrefix(dir), module, suffixes[i % LEN(suffixes)]);
-	} while ((i < LEN(suffixes)) && ! Files_Exists(result));
-
-	return result;
+	}
+	return Util_String("%s%s%s", AsPrefix(dir), module, suffixes[i % LEN(suffixes)]);
 }
 
 
@@ -88,13 +166,19 @@ static char *ModulePrefix(const char module[])
 }
 
 
+static int HasSourceFile(const char dir[], const char module[])
+{
+	return Contains(dir, Util_String("%s.obn", module))
+		|| Contains(dir, Util_String("%s.Mod", module))
+		|| Contains(dir, Util_String("%s.mod", module));
+}
+
+
 static const char *SearchDir(const char dir[], const char module[])
 {
-	const char *oberonFile = ModulePaths_SourceFile(module, dir);
-	const char *localSymfile = Util_String("%s/.obnc/%s.sym", dir, module);
-	const char *globalSymfile = Util_String("%s/%s.sym", dir, module);
+	const char *symfile = Util_String("%s.sym", module);
 
-	return (Files_Exists(oberonFile) || Files_Exists(localSymfile) || Files_Exists(globalSymfile))
+	return (HasSourceFile(dir, module) || Contains(Util_String("%s/.obnc", dir), symfile) || Contains(dir, symfile))
 		? dir
 		: NULL;
 }
@@ -26,6 +26,7 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 #include "ModulePaths.h"
 #include "Paths.h"
 #include "Range.h"
+#include "Stats.h"
 #include "Table.h"
 #include "Types.h"
 #include "Trees.h"
@@ -102,6 +103,11 @@ static void CheckCaseLabelUniqueness(Trees_Node label);
 /*functions for module productions*/
 
 static void ExportSymbolTable(const char symfilePath[]);
+
+/*with statistics enabled, the time spent in the lexer is separated from the time spent in the parser*/
+
+static int TimedLex(void);
+#define yylex() TimedLex()
 %}
 
 %union {
@@ -2074,7 +2080,9 @@ module:
 					Files_Remove(symfilePath);
 				}
 			} else {
+				Stats_Enter(STATS_EXPORT);
 				ExportSymbolTable(symfilePath);
+				Stats_Leave();
 			}
 			YYACCEPT;
 		} else {
@@ -2239,7 +2247,9 @@ import:
 						}
 						symbolFileName = Util_String("%s/%s.sym", symbolFileDir, module);
 						if (Files_Exists(symbolFileName)) {
+							Stats_Enter(STATS_IMPORT);
 							Table_Import(symbolFileName, module, qualifier);
+							Stats_Leave();
 						} else {
 							Oberon_PrintError("error: symbol file not found for module %s: %s", module, symbolFileName);
 							YYABORT;
@@ -2292,6 +2302,7 @@ void Oberon_Init(void)
 		Files_Init();
 		Generate_Init();
 		ModulePaths_Init();
+		Stats_Init();
 		Table_Init();
 	}
 }
@@ -2326,7 +2337,9 @@ void Oberon_Parse(const char inputFile[], int mode)
 				}
 			}
 		}
+		Stats_Enter(STATS_PARSING);
 		error = yyparse();
+		Stats_Leave();
 		if (error) {
 			exit(EXIT_FAILURE);
 		}
@@ -4190,3 +4203,14 @@ static void ExportSymbolTable(const char symfilePath[])
 	Table_Export(tempSymfilePath);
 	Files_Move(tempSymfilePath, symfilePath);
 }
+
+
+static int TimedLex(void)
+{
+	int token;
+
+	Stats_Enter(STATS_LEXING);
+	token = (yylex)();
+	Stats_Leave();
+	return token;
+}
@@ -0,0 +1,207 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#include "Stats.h"
+#include "Util.h"
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/time.h> /*POSIX*/
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_DEPTH 16
+
+static const struct { const char *name, *key; } phases[STATS_PHASE_COUNT] = {
+	{"lexing", "lexing"},
+	{"parsing and checks", "parsing"},
+	{"symbol file import", "import"},
+	{"code generation", "generation"},
+	{"symbol file export", "export"}};
+
+static const struct { const char *name, *key; } counters[STATS_COUNTER_COUNT] = {
+	{"tree nodes", "tree_nodes"},
+	{"declared symbols", "declared_symbols"},
+	{"scopes", "scopes"},
+	{"imported symbol files", "symbol_files"},
+	{"imported symbols", "imported_symbols"},
+	{"symbol file bytes", "symbol_file_bytes"}};
+
+static int initialized = 0;
+static int started;
+static double startTime, lastTime; /*microseconds*/
+static double phaseTimes[STATS_PHASE_COUNT];
+static long counts[STATS_COUNTER_COUNT];
+static int phaseStack[MAX_DEPTH];
+static int depth;
+
+void Stats_Init(void)
+{
+	if (! initialized) {
+		initialized = 1;
+		Util_Init();
+	}
+}
+
+
+static double Now(void)
+{
+#ifdef _WIN32
+	return (double) GetTickCount() * 1000.0;
+#else
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return (double) t.tv_sec * 1.0e6 + (double) t.tv_usec;
+#endif
+}
+
+
+void Stats_Start(void)
+{
+	assert(initialized);
+	started = 1;
+	startTime = Now();
+	lastTime = startTime;
+}
+
+
+int Stats_Started(void)
+{
+	return started;
+}
+
+
+/*charges the time since the last phase change to the current phase*/
+static void Charge(void)
+{
+	double now;
+
+	now = Now();
+	if (depth > 0) {
+		phaseTimes[phaseStack[depth - 1]] += now - lastTime;
+	}
+	lastTime = now;
+}
+
+
+void Stats_Enter(int phase)
+{
+	assert((phase >= 0) && (phase < STATS_PHASE_COUNT));
+
+	if (started) {
+		assert(depth < MAX_DEPTH);
+		Charge();
+		phaseStack[depth] = phase;
+		depth++;
+	}
+}
+
+
+void Stats_Leave(void)
+{
+	if (started) {
+		assert(depth > 0);
+		Charge();
+		depth--;
+	}
+}
+
+
+void Stats_Add(int counter, long n)
+{
+	assert((counter >= 0) && (counter < STATS_COUNTER_COUNT));
+	counts[counter] += n;
+}
+
+
+static double Milliseconds(double microseconds)
+{
+	return microseconds / 1000.0;
+}
+
+
+static double OtherTime(double total)
+{
+	double result;
+	int i;
+
+	result = total;
+	for (i = 0; i < STATS_PHASE_COUNT; i++) {
+		result -= phaseTimes[i];
+	}
+	return result;
+}
+
+
+void Stats_Print(FILE *file, const char inputFile[])
+{
+	double total;
+	int i;
+
+	assert(started);
+	total = Now() - startTime;
+
+	fprintf(file, "\nCompiler statistics for %s:\n\n", inputFile);
+	fprintf(file, "Phase                      Time (ms)\n");
+	fprintf(file, "------------------------------------\n");
+	for (i = 0; i < STATS_PHASE_COUNT; i++) {
+		fprintf(file, "%-22s %13.3f\n", phases[i].name, Milliseconds(phaseTimes[i]));
+	}
+	fprintf(file, "%-22s %13.3f\n", "other", Milliseconds(OtherTime(total)));
+	fprintf(file, "%-22s %13.3f\n", "total", Milliseconds(total));
+	fprintf(file, "\nCounter                        Value\n");
+	fprintf(file, "------------------------------------\n");
+	for (i = 0; i < STATS_COUNTER_COUNT; i++) {
+		fprintf(file, "%-22s %13ld\n", counters[i].name, counts[i]);
+	}
+	fprintf(file, "%-22s %13lu\n", "GC heap bytes", (unsigned long) GC_get_heap_size());
+	fprintf(file, "%-22s %13lu\n", "GC allocated bytes", (unsigned long) GC_get_total_bytes());
+	fprintf(file, "%-22s %13lu\n", "GC collections", (unsigned long) GC_get_gc_no());
+	fprintf(file, "------------------------------------\n");
+}
+
+
+void Stats_PrintJSON(FILE *file, const char inputFile[])
+{
+	double total;
+	int i;
+
+	assert(started);
+	total = Now() - startTime;
+
+	fprintf(file, "{\n\t\"file\": \"");
+	for (i = 0; inputFile[i] != '\0'; i++) {
+		if ((inputFile[i] == '"') || (inputFile[i] == '\\')) {
+			fputc('\\', file);
+		}
+		fputc(inputFile[i], file);
+	}
+	fprintf(file, "\",\n\t\"time_ms\": {");
+	for (i = 0; i < STATS_PHASE_COUNT; i++) {
+		fprintf(file, "\"%s\": %.3f, ", phases[i].key, Milliseconds(phaseTimes[i]));
+	}
+	fprintf(file, "\"other\": %.3f, \"total\": %.3f},\n", Milliseconds(OtherTime(total)), Milliseconds(total));
+	for (i = 0; i < STATS_COUNTER_COUNT; i++) {
+		fprintf(file, "\t\"%s\": %ld,\n", counters[i].key, counts[i]);
+	}
+	fprintf(file, "\t\"gc_heap_bytes\": %lu,\n", (unsigned long) GC_get_heap_size());
+	fprintf(file, "\t\"gc_allocated_bytes\": %lu,\n", (unsigned long) GC_get_total_bytes());
+	fprintf(file, "\t\"gc_collections\": %lu\n}\n", (unsigned long) GC_get_gc_no());
+}
@@ -0,0 +1,58 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+/*compiler phases*/
+#define STATS_LEXING 0
+#define STATS_PARSING 1 /*including semantic checks*/
+#define STATS_IMPORT 2
+#define STATS_GENERATION 3
+#define STATS_EXPORT 4
+#define STATS_PHASE_COUNT 5
+
+/*counters*/
+#define STATS_TREE_NODES 0
+#define STATS_DECLARED_SYMBOLS 1
+#define STATS_SCOPES 2
+#define STATS_SYMBOL_FILES 3
+#define STATS_IMPORTED_SYMBOLS 4
+#define STATS_SYMBOL_FILE_BYTES 5
+#define STATS_COUNTER_COUNT 6
+
+void Stats_Init(void);
+
+/*starts collecting statistics; until then the procedures below do nothing*/
+void Stats_Start(void);
+
+int Stats_Started(void);
+
+/*Time is charged to the innermost phase entered, so a phase which is entered from another one, like STATS_LEXING from STATS_PARSING, is excluded from the outer phase.*/
+void Stats_Enter(int phase);
+
+void Stats_Leave(void);
+
+void Stats_Add(int counter, long n);
+
+void Stats_Print(FILE *file, const char inputFile[]);
+
+void Stats_PrintJSON(FILE *file, const char inputFile[]);
+
+#endif
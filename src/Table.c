@@ -19,6 +19,7 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 #include "Config.h"
 #include "Files.h"
 #include "Maps.h"
+#include "Stats.h"
 #include "Trees.h"
 #include "Types.h"
 #include "Util.h"
@@ -156,6 +157,7 @@ void Table_Put(Trees_Node identNode)
 	assert(! Table_LocallyDeclared(name));
 
 	Maps_Put(name, identNode, &(currentScope->symbols));
+	Stats_Add(STATS_DECLARED_SYMBOLS, 1);
 }
 
 
@@ -264,6 +266,7 @@ void Table_OpenScope(void)
 	newScope->symbols = Maps_New();
 	newScope->parent = currentScope;
 	currentScope = newScope;
+	Stats_Add(STATS_SCOPES, 1);
 
 	assert(currentScope != globalScope);
 }
@@ -958,7 +961,7 @@ static char *QualifiedName(const char qualifier[], const char name[])
 	size_t resultLen;
 	char *result;
 
-	resultLen = strlen(qualifier) + strlen(".") + strlen(name) + strlen("\0");
+	resultLen = strlen(qualifier) + strlen(".") + strlen(name) + 1;
 	NEW_ARRAY(result, resultLen);
 	strcpy(result, qualifier);
 	strcat(result, ".");
@@ -1008,6 +1011,7 @@ void Table_Import(const char filename[], const char module[], const char qualifi
 		ReadSExp(1, importFile, &ident);
 		if (ident != NULL) {
 			Maps_Put(Trees_Name(ident), ident, &symbolFileEntries);
+			Stats_Add(STATS_IMPORTED_SYMBOLS, 1);
 			if (Trees_Imported(ident)) {
 				importEntries = Trees_NewNode(TREES_NOSYM, ident, importEntries);
 			}
@@ -1031,6 +1035,8 @@ void Table_Import(const char filename[], const char module[], const char qualifi
 	assert(qualifierIdent != NULL);
 	Trees_SetLeft(importEntries, qualifierIdent);
 
+	Stats_Add(STATS_SYMBOL_FILES, 1);
+	Stats_Add(STATS_SYMBOL_FILE_BYTES, ftell(importFile));
 	Files_Close(&importFile);
 	importFile = NULL;
 	importFilename = NULL;
@@ -0,0 +1,219 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#include "Trace.h"
+#include "Files.h"
+#include "Util.h"
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <sys/resource.h> /*POSIX*/
+	#include <sys/time.h> /*POSIX*/
+#endif
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct SpanDesc *Span;
+
+struct SpanDesc {
+	const char *name, *category;
+	double wallStart, cpuStart; /*microseconds*/
+	Span next;
+};
+
+static int initialized = 0;
+static FILE *traceFile;
+static int eventCount;
+static double traceStart;
+static Span spans; /*stack of open spans*/
+
+void Trace_Init(void)
+{
+	if (! initialized) {
+		initialized = 1;
+		Files_Init();
+		Util_Init();
+	}
+}
+
+
+#ifdef _WIN32
+
+static double WallTime(void)
+{
+	return (double) GetTickCount() * 1000.0;
+}
+
+
+static double CPUTime(void)
+{
+	return (double) clock() / (double) CLOCKS_PER_SEC * 1.0e6;
+}
+
+#else /*POSIX*/
+
+static double WallTime(void)
+{
+	struct timeval t;
+
+	gettimeofday(&t, NULL);
+	return (double) t.tv_sec * 1.0e6 + (double) t.tv_usec;
+}
+
+
+static double UsageTime(int who)
+{
+	struct rusage usage;
+	int error;
+	double result;
+
+	result = 0.0;
+	error = getrusage(who, &usage);
+	if (! error) {
+		result = (double) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1.0e6
+			+ (double) (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+	}
+	return result;
+}
+
+
+static double CPUTime(void) /*includes terminated child processes, i.e. the compilers*/
+{
+	return UsageTime(RUSAGE_SELF) + UsageTime(RUSAGE_CHILDREN);
+}
+
+#endif
+
+static const char *JSONString(const char s[])
+{
+	char *result;
+	int i, j;
+
+	NEW_ARRAY(result, 6 * strlen(s) + 3);
+	j = 0;
+	result[j] = '"';
+	j++;
+	for (i = 0; s[i] != '\0'; i++) {
+		if ((s[i] == '"') || (s[i] == '\\')) {
+			result[j] = '\\';
+			result[j + 1] = s[i];
+			j += 2;
+		} else if ((unsigned char) s[i] < 0x20) {
+			sprintf(result + j, "\\u%04x", (unsigned char) s[i]);
+			j += 6;
+		} else {
+			result[j] = s[i];
+			j++;
+		}
+	}
+	result[j] = '"';
+	result[j + 1] = '\0';
+	return result;
+}
+
+
+static void WriteEvent(const char name[], const char category[], const char phase[], double start, const char fields[], const char args[])
+{
+	fprintf(traceFile, "%s{\"name\": %s, \"cat\": %s, \"ph\": \"%s\", \"ts\": %.0f, %s\"pid\": 1, \"tid\": 1, \"args\": {%s}}",
+		(eventCount > 0)? ",\n": "",
+		JSONString(name), JSONString(category), phase, start - traceStart, fields, (args != NULL)? args: "");
+	eventCount++;
+}
+
+
+static void Close(void)
+{
+	/*spans which are still open when the program exits belong to a failed build*/
+	while (spans != NULL) {
+		Trace_End(Trace_Arg("status", "failed"));
+	}
+	fputs("\n]\n", traceFile);
+	Files_Close(&traceFile);
+}
+
+
+void Trace_Open(const char filename[])
+{
+	assert(initialized);
+	assert(filename != NULL);
+	assert(traceFile == NULL);
+
+	traceFile = Files_New(filename);
+	fputs("[\n", traceFile);
+	traceStart = WallTime();
+	atexit(Close);
+}
+
+
+int Trace_Enabled(void)
+{
+	return traceFile != NULL;
+}
+
+
+const char *Trace_Arg(const char key[], const char value[])
+{
+	return Util_String("%s: %s", JSONString(key), JSONString(value));
+}
+
+
+void Trace_Begin(const char name[], const char category[])
+{
+	Span span;
+
+	if (traceFile != NULL) {
+		NEW(span);
+		span->name = Util_String("%s", name);
+		span->category = Util_String("%s", category);
+		span->wallStart = WallTime();
+		span->cpuStart = CPUTime();
+		span->next = spans;
+		spans = span;
+	}
+}
+
+
+void Trace_End(const char args[])
+{
+	Span span;
+	double wallTime, cpuTime;
+	const char *allArgs;
+
+	if (traceFile != NULL) {
+		assert(spans != NULL);
+		span = spans;
+		spans = spans->next;
+		wallTime = WallTime() - span->wallStart;
+		cpuTime = CPUTime() - span->cpuStart;
+		allArgs = Util_String("\"cpu_us\": %ld", (long) cpuTime);
+		if ((args != NULL) && (strcmp(args, "") != 0)) {
+			allArgs = Util_String("%s, %s", allArgs, args);
+		}
+		WriteEvent(span->name, span->category, "X", span->wallStart, Util_String("\"dur\": %ld, ", (long) wallTime), allArgs);
+	}
+}
+
+
+void Trace_Instant(const char name[], const char category[], const char args[])
+{
+	if (traceFile != NULL) {
+		WriteEvent(name, category, "i", WallTime(), "\"s\": \"t\", ", args);
+	}
+}
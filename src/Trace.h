@@ -0,0 +1,40 @@
+/*Copyright 2017-2019, 2023, 2024 Karl Landstrom <karl@miasap.se>
+
+This file is part of OBNC.
+
+OBNC is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+OBNC is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/*Build tracing in the Chrome trace event format, as read by chrome://tracing and Perfetto. Until Trace_Open is called, the other procedures do nothing.*/
+
+void Trace_Init(void);
+
+void Trace_Open(const char filename[]);
+
+int Trace_Enabled(void);
+
+/*returns the JSON object member "key": "value", for use in the args parameters below*/
+const char *Trace_Arg(const char key[], const char value[]);
+
+/*starts a span; spans are nested and each one is ended with Trace_End*/
+void Trace_Begin(const char name[], const char category[]);
+
+/*ends the latest span and records its wall time and CPU time, including the CPU time of child processes; args is a comma-separated list of JSON object members, or NULL*/
+void Trace_End(const char args[]);
+
+void Trace_Instant(const char name[], const char category[], const char args[]);
+
+#endif
@@ -17,6 +17,7 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 
 #include "Trees.h"
 #include "lex.yy.h"
+#include "Stats.h"
 #include "Util.h"
 #include "../lib/obnc/OBNC.h"
 #include "y.tab.h"
@@ -78,6 +79,7 @@ Trees_Node Trees_NewNode(int symbol, Trees_Node left, Trees_Node right)
 
 	assert(initialized);
 	NEW(result);
+	Stats_Add(STATS_TREE_NODES, 1);
 	result->valueType = NO_VALUE;
 	result->symbol = symbol;
 	result->lineNumber = yylineno;
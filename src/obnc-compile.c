@@ -17,8 +17,11 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 
 #include "Config.h"
 #include "Error.h"
+#include "Files.h"
+#include "Generate.h"
 #include "Oberon.h"
 #include "StackTrace.h"
+#include "Stats.h"
 #include "Util.h"
 #include "../lib/obnc/OBNC.h" /*needed by YYSTYPE in y.tab.h*/
 #include "Trees.h" /*needed by YYSTYPE in y.tab.h*/
@@ -33,13 +36,16 @@ static void PrintHelp(void)
 	puts("obnc-compile - compile an Oberon module to C");
 	puts("");
 	puts("usage:");
-	puts("\tobnc-compile [-e | -l] INFILE");
+	puts("\tobnc-compile [-e | -l] [--checks=SPEC] [--stats[=FILE]] INFILE");
 	puts("\tobnc-compile (-h | -v)");
 	puts("");
 	puts("\t-e\tcreate entry point function (main)");
 	puts("\t-h\tdisplay help and exit");
 	puts("\t-l\tprint names of imported modules and exit");
 	puts("\t-v\tdisplay version and exit");
+	puts("\t--checks=SPEC\tselect runtime checks, see obnc-compile(1)");
+	puts("\t--stats\tprint phase timings, counts and memory use to standard error");
+	puts("\t--stats=FILE\twrite the statistics to FILE in JSON format");
 	puts("");
 	puts("\tINFILE is expected to end with .obn, .Mod or .mod");
 }
@@ -91,10 +97,14 @@ int main(int argc, char *argv[])
 	int helpWanted = 0;
 	int versionWanted = 0;
 	int mode = OBERON_NORMAL_MODE;
-	const char *arg, *inputFile = NULL, *fileSuffix;
+	const char *arg, *inputFile = NULL, *fileSuffix, *statsFile = NULL;
+	int statsWanted = 0;
+	FILE *fp;
 
 	Error_Init();
+	Generate_Init();
 	Oberon_Init();
+	Stats_Init();
 	Util_Init();
 	StackTrace_Init(PrintContext);
 
@@ -110,6 +120,15 @@ int main(int argc, char *argv[])
 			mode = OBERON_ENTRY_POINT_MODE;
 		} else if (strcmp(arg, "-l") == 0) {
 			mode = OBERON_IMPORT_LIST_MODE;
+		} else if (strncmp(arg, "--checks=", strlen("--checks=")) == 0) {
+			if (! Generate_SetChecks(arg + strlen("--checks="))) {
+				Error_Handle(Util_String("invalid checks: %s", arg + strlen("--checks=")));
+			}
+		} else if (strcmp(arg, "--stats") == 0) {
+			statsWanted = 1;
+		} else if ((strncmp(arg, "--stats=", strlen("--stats=")) == 0) && (arg[strlen("--stats=")] != '\0')) {
+			statsWanted = 1;
+			statsFile = arg + strlen("--stats=");
 		} else if ((arg[0] != '-') && (inputFile == NULL)) {
 			fileSuffix = strrchr(arg, '.');
 			if ((fileSuffix != NULL)
@@ -131,7 +150,19 @@ int main(int argc, char *argv[])
 		PrintVersion();
 	} else if (inputFile != NULL) {
 		Error_SetHandler(ExitFailure);
+		if (statsWanted) {
+			Stats_Start();
+		}
 		Oberon_Parse(inputFile, mode);
+		if (statsWanted) {
+			if (statsFile != NULL) {
+				fp = Files_New(statsFile);
+				Stats_PrintJSON(fp, inputFile);
+				Files_Close(&fp);
+			} else {
+				Stats_Print(stderr, inputFile);
+			}
+		}
 	} else {
 		Error_Handle("");
 	}
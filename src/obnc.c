@@ -19,9 +19,11 @@ along with OBNC.  If not, see <http://www.gnu.org/licenses/>.*/
 #include "ElapsedTime.h"
 #include "Error.h"
 #include "Files.h"
+#include "Imports.h"
 #include "ModulePaths.h"
 #include "Paths.h"
 #include "StackTrace.h"
+#include "Trace.h"
 #include "Util.h"
 #include <sys/stat.h> /*POSIX*/
 #include <assert.h>
@@ -166,29 +168,36 @@ static void GetImportedModulesFromImpFile(const char impFile[], char ***imported
 }
 
 
-static void GetImportedModulesFromSourceFile(const char oberonFile[], char ***importedModules, int *importedModulesLen)
+static void GetImportedModulesFromSourceFile(const char oberonFile[], const char module[], char ***importedModules, int *importedModulesLen)
 {
 	const char *dir, *file;
 	const char *command;
 	FILE *fp;
-	int status;
-
-	dir = Paths_Dirname(oberonFile);
-	file = Paths_Basename(oberonFile);
-	command = Util_String("cd %s && %s -l %s", Paths_ShellArg(dir), Paths_ShellArg(ObncCompilerPath()), Paths_ShellArg(file));
-	fp = popen(command, "r");
-	if (fp != NULL) {
-		ReadLines(fp, importedModules, importedModulesLen);
-		status = pclose(fp);
-		if (status != 0) {
-			if (status < 0) {
-				Error_Handle(Util_String("closing pipe failed: %s", strerror(errno)));
-			} else {
-				Error_Handle("");
+	int done, status;
+
+	/*read the import list directly; if the module heading is not well-formed, let the compiler report the error*/
+	fp = Files_Old(oberonFile, FILES_READ);
+	done = Imports_Read(fp, module, importedModules, importedModulesLen);
+	Files_Close(&fp);
+
+	if (! done) {
+		dir = Paths_Dirname(oberonFile);
+		file = Paths_Basename(oberonFile);
+		command = Util_String("cd %s && %s -l %s", Paths_ShellArg(dir), Paths_ShellArg(ObncCompilerPath()), Paths_ShellArg(file));
+		fp = popen(command, "r");
+		if (fp != NULL) {
+			ReadLines(fp, importedModules, importedModulesLen);
+			status = pclose(fp);
+			if (status != 0) {
+				if (status < 0) {
+					Error_Handle(Util_String("closing pipe failed: %s", strerror(errno)));
+				} else {
+					Error_Handle("");
+				}
 			}
+		} else {
+			Error_Handle(Util_String("getting imported modules failed: %s", strerror(errno)));
 		}
-	} else {
-		Error_Handle(Util_String("getting imported modules failed: %s", strerror(errno)));
 	}
 }
 
@@ -201,17 +210,19 @@ static void GetImportedFiles(const char module[], const char dir[], char ***impo
 
 	oberonFile = ModulePaths_SourceFile(module, dir);
 
-	/*get imported modules*/
-	impFile = Util_String("%s/.obnc/%s.imp", dir, module);
-	if (! Files_Exists(impFile)) {
-		impFile = Util_String("%s/%s.imp", dir, module);
-	}
-	if (Files_Exists(impFile) && (! Files_Exists(oberonFile) || (Files_Timestamp(impFile) >= Files_Timestamp(oberonFile)))) {
-		GetImportedModulesFromImpFile(impFile, &importedModules, &importedModulesLen);
-	} else if (Files_Exists(oberonFile)) {
-		GetImportedModulesFromSourceFile(oberonFile, &importedModules, &importedModulesLen);
+	/*get imported modules; the source file is always up to date, so the import file is only needed for modules without source*/
+	if (Files_Exists(oberonFile)) {
+		GetImportedModulesFromSourceFile(oberonFile, module, &importedModules, &importedModulesLen);
 	} else {
-		importedModulesLen = 0;
+		impFile = Util_String("%s/.obnc/%s.imp", dir, module);
+		if (! Files_Exists(impFile)) {
+			impFile = Util_String("%s/%s.imp", dir, module);
+		}
+		if (Files_Exists(impFile)) {
+			GetImportedModulesFromImpFile(impFile, &importedModules, &importedModulesLen);
+		} else {
+			importedModulesLen = 0;
+		}
 	}
 
 	*importedFilesLen = importedModulesLen;
@@ -249,43 +260,6 @@ static void DetectImportCycle(const char importedModule[], const char moduleDir[
 }
 
 
-static void CompileOberon(const char module[], const char dir[], int isEntryPoint)
-{
-	const char *outputDir, *inputFile, *symFile, *symBakFile, *entryPointOption, *command;
-	int error, start;
-
-	outputDir = Util_String("%s/.obnc", dir);
-
-	/*backup current symbol file*/
-	symFile = Util_String("%s/%s.sym", outputDir, module);
-	symBakFile = Util_String("%s.bak", symFile);
-	if (Files_Exists(symFile)) {
-		Files_Move(symFile, symBakFile);
-	} else {
-		if (! Files_Exists(outputDir)) {
-			Files_CreateDir(outputDir);
-		}
-	}
-
-	entryPointOption = isEntryPoint? "-e": "";
-	inputFile = Paths_Basename(ModulePaths_SourceFile(module, dir));
-	if (strcmp(dir, ".") == 0) {
-		command = Util_String("%s %s %s", Paths_ShellArg(ObncCompilerPath()), entryPointOption, Paths_ShellArg(inputFile));
-	} else {
-		command = Util_String("cd %s && %s %s %s", Paths_ShellArg(dir), Paths_ShellArg(ObncCompilerPath()), entryPointOption, Paths_ShellArg(inputFile));
-	}
-	if (verbosity == 2) {
-		puts(command);
-	}
-	start = ElapsedTime();
-	error = system(command);
-	obncCompileTotalTime += ElapsedTime() - start;
-	if (error) {
-		Error_Handle("");
-	}
-}
-
-
 static char *UnquotedString(const char s[])
 {
 	int sLen;
@@ -334,6 +308,56 @@ static void ReadEnvFile(const char filename[], char **keys[], char **values[], i
 }
 
 
+static void CompileOberon(const char module[], const char dir[], int isEntryPoint)
+{
+	const char *outputDir, *inputFile, *symFile, *symBakFile, *envFile, *entryPointOption, *checksOption, *command;
+	char **keys, **values;
+	int len, i, error, start;
+
+	outputDir = Util_String("%s/.obnc", dir);
+
+	/*backup current symbol file*/
+	symFile = Util_String("%s/%s.sym", outputDir, module);
+	symBakFile = Util_String("%s.bak", symFile);
+	if (Files_Exists(symFile)) {
+		Files_Move(symFile, symBakFile);
+	} else {
+		if (! Files_Exists(outputDir)) {
+			Files_CreateDir(outputDir);
+		}
+	}
+
+	entryPointOption = isEntryPoint? "-e": "";
+	checksOption = "";
+	envFile = Util_String("%s/%s.env", dir, module);
+	if (Files_Exists(envFile)) {
+		ReadEnvFile(envFile, &keys, &values, &len);
+		for (i = 0; i < len; i++) {
+			if (strcmp(keys[i], "CHECKS") == 0) {
+				checksOption = Paths_ShellArg(Util_String("--checks=%s", values[i]));
+			}
+		}
+	}
+	inputFile = Paths_Basename(ModulePaths_SourceFile(module, dir));
+	if (strcmp(dir, ".") == 0) {
+		command = Util_String("%s %s %s %s", Paths_ShellArg(ObncCompilerPath()), entryPointOption, checksOption, Paths_ShellArg(inputFile));
+	} else {
+		command = Util_String("cd %s && %s %s %s %s", Paths_ShellArg(dir), Paths_ShellArg(ObncCompilerPath()), entryPointOption, checksOption, Paths_ShellArg(inputFile));
+	}
+	if (verbosity == 2) {
+		puts(command);
+	}
+	Trace_Begin(Util_String("obnc-compile %s", module), "obnc-compile");
+	start = ElapsedTime();
+	error = system(command);
+	obncCompileTotalTime += ElapsedTime() - start;
+	Trace_End(Util_String("%s, %s", Trace_Arg("module", module), Trace_Arg("dir", dir)));
+	if (error) {
+		Error_Handle("");
+	}
+}
+
+
 static char *CCompiler(void)
 {
 	char *cc, *result;
@@ -400,9 +424,11 @@ static void CompileC(const char module[], const char dir[])
 			&& (strstr(cFlags, "OBNC_CONFIG_TARGET_EMB=") != NULL)) {
 		Error_Handle("OBNC_CONFIG_NO_GC and OBNC_CONFIG_TARGET_EMB cannot be used simultaneously");
 	}
+	Trace_Begin(Util_String("cc %s", module), "cc");
 	start = ElapsedTime();
 	error = system(command);
 	ccCompileTotalTime += ElapsedTime() - start;
+	Trace_End(Util_String("%s, %s, %s, %s", Trace_Arg("module", module), Trace_Arg("dir", dir), Trace_Arg("cc", cc), Trace_Arg("cflags", cFlags)));
 	if (error) {
 		Error_Handle("");
 	}
@@ -455,6 +481,7 @@ static void UpdateObjectFile(const char module[], const char dir[], int stale, i
 	oberonCompilationNeeded = 0;
 	if (stale
 		|| ! Files_Exists(genCFile) || (Files_Timestamp(genCFile) < Files_Timestamp(oberonFile)
+		|| (Files_Exists(envFile) && (Files_Timestamp(genCFile) < Files_Timestamp(envFile))) /*CHECKS may have changed*/
 		|| (isEntryPoint && Files_Exists(symFile))
 		|| (! isEntryPoint && (
 			! Files_Exists(symFile) || (Files_Timestamp(symFile) < Files_Timestamp(oberonFile))
@@ -474,6 +501,11 @@ static void UpdateObjectFile(const char module[], const char dir[], int stale, i
 		}
 	}
 
+	if (Trace_Enabled()) {
+		Trace_Instant(Util_String("%s %s", (oberonCompilationNeeded || cCompilationNeeded)? "cache miss": "cache hit", module), "cache",
+			Util_String("%s, \"obnc-compile\": %s, \"cc\": %s", Trace_Arg("module", module),
+				oberonCompilationNeeded? "true": "false", cCompilationNeeded? "true": "false"));
+	}
 	if (oberonCompilationNeeded || cCompilationNeeded) {
 		Compile(module, dir, oberonCompilationNeeded, isEntryPoint);
 	}
@@ -517,10 +549,13 @@ static void Traverse1(const char module[], const char dir[], ModuleList nodePath
 	ModuleList newNodePath, p, moduleNode;
 
 	*discoveredModules = NewModuleNode(module, dir, *discoveredModules);
+	Trace_Begin(Util_String("module %s", module), "module");
 
 	/*traverse imported files*/
 	stale = 0;
+	Trace_Begin(Util_String("imports %s", module), "imports");
 	GetImportedFiles(module, dir, &importedFiles, &importedFilesLen);
+	Trace_End(Trace_Arg("module", module));
 	for (i = 0; i < importedFilesLen; i++) {
 		importedModule = Paths_SansSuffix(Paths_Basename(importedFiles[i]));
 		importedModuleDir = Paths_Dirname(importedFiles[i]);
@@ -552,6 +587,7 @@ static void Traverse1(const char module[], const char dir[], ModuleList nodePath
 	moduleNode = MatchingModuleNode(module, dir, *discoveredModules);
 	assert(moduleNode != NULL);
 	moduleNode->stale = ! newSymFileCompatible;
+	Trace_End(Util_String("%s, %s", Trace_Arg("module", module), Trace_Arg("dir", dir)));
 }
 
 
@@ -707,6 +743,7 @@ static void CreateExecutable(const char *inputFiles[], int inputFilesLen)
 	} else if (verbosity == 2) {
 		printf("\nCreating executable %s:\n\n%s\n", executableFile, command);
 	}
+	Trace_Begin(Util_String("link %s", executableFile), "link");
 	start = ElapsedTime();
 	error = system(command);
 	if (buildUnified) {
@@ -714,6 +751,7 @@ static void CreateExecutable(const char *inputFiles[], int inputFilesLen)
 	} else {
 		ccLinkTotalTime += ElapsedTime() - start;
 	}
+	Trace_End(Trace_Arg("command", command));
 	if (error) {
 		Error_Handle("");
 	}
@@ -759,6 +797,7 @@ static void Build(const char oberonFile[])
 	int ccInputFilesLen, i;
 	const char **ccInputFiles;
 
+	Trace_Begin(Util_String("build %s", executableFile), "build");
 	discoveredModules = NULL;
 	Traverse(oberonFile, &discoveredModules);
 
@@ -798,6 +837,7 @@ static void Build(const char oberonFile[])
 	} else {
 		printf("%s is up to date\n", executableFile);
 	}
+	Trace_End(NULL);
 }
 
 
@@ -805,12 +845,13 @@ static void PrintHelp(void)
 {
 	puts("obnc - build an executable for an Oberon module\n");
 	puts("usage:");
-	puts("\tobnc [-o OUTFILE] [-v | -V] [-x] INFILE");
+	puts("\tobnc [-o OUTFILE] [-v | -V] [-x] [--trace=FILE] INFILE");
 	puts("\tobnc (-h | -v)\n");
 	puts("\t-o\tuse pathname OUTFILE for generated executable");
 	puts("\t-v\tlog compiled modules or display version and exit");
 	puts("\t-V\tlog compiler and linker commands");
 	puts("\t-x\tcompile and link C files in one command (for cross compilation)");
+	puts("\t--trace=FILE\twrite build timings to FILE in Chrome trace event format");
 	puts("\t-h\tdisplay help and exit");
 	puts("");
 	puts("\tINFILE is expected to end with .obn, .Mod or .mod");
@@ -854,7 +895,7 @@ static void ExitFailure(const char msg[])
 int main(int argc, char *argv[])
 {
 	int i, hSet = 0, vSet = 0, VSet = 0;
-	const char *arg, *inputFile = NULL, *fileSuffix;
+	const char *arg, *inputFile = NULL, *traceFile = NULL, *fileSuffix;
 
 	startTime = ElapsedTime();
 	Config_Init();
@@ -863,6 +904,7 @@ int main(int argc, char *argv[])
 	ModulePaths_Init();
 	Util_Init();
 	StackTrace_Init(NULL);
+	Trace_Init();
 
 	Error_SetHandler(ExitInvalidCommand);
 
@@ -884,6 +926,11 @@ int main(int argc, char *argv[])
 			VSet = 1;
 		} else if (strcmp(arg, "-x") == 0) {
 			buildUnified = 1;
+		} else if (strncmp(arg, "--trace=", strlen("--trace=")) == 0) {
+			traceFile = arg + strlen("--trace=");
+			if (strcmp(traceFile, "") == 0) {
+				Error_Handle("output file parameter expected for option --trace");
+			}
 		} else if (arg[0] == '-') {
 			Error_Handle(Util_String("invalid option: `%s'", arg));
 		} else if (inputFile == NULL) {
@@ -924,6 +971,9 @@ int main(int argc, char *argv[])
 		} else if (vSet) {
 			verbosity = 1;
 		}
+		if (traceFile != NULL) {
+			Trace_Open(traceFile);
+		}
 		Build(inputFile);
 	} else {
 		Error_Handle("no input file");